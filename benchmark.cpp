@@ -0,0 +1,438 @@
+#include "btree.h"
+#include <chrono>
+#include <random>
+#include <functional>
+#include <cmath>
+#include <cstdio>
+#include <unistd.h>
+#include <zstd.h>
+
+using namespace std;
+
+// Microbenchmarks del nucleo del B-Tree, sin servidor HTTP. Cada caso se repite --reps veces
+// (mas --warmup descartadas) con datos deterministas segun --seed; la salida es JSON o CSV.
+
+struct Options {
+    vector<size_t> sizes = { 10000, 100000, 1000000 };
+    vector<int> degrees = { 16, 256, 33000 };
+    int reps = 5;
+    int warmup = 1;
+    size_t queries = 100000;
+    uint64_t seed = 42;
+    string filter;
+    string format = "json";
+    string out;
+    string tmpdir = "/tmp";
+};
+
+struct Timer {
+    chrono::steady_clock::time_point begin;
+    double elapsed_ns = 0;
+
+    void start() { begin = chrono::steady_clock::now(); }
+    void stop() { elapsed_ns += chrono::duration<double, nano>(chrono::steady_clock::now() - begin).count(); }
+};
+
+struct Result {
+    string name;
+    size_t size;
+    int degree;
+    size_t ops;
+    vector<double> ns_per_op;
+    uint64_t bytes;
+    uint64_t compressed_bytes;
+};
+
+// Los metodos del arbol informan por cout; durante las mediciones esa salida se descarta
+class NullBuffer : public streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+static volatile size_t sink;
+
+struct Row {
+    string dni;
+    string fields[9];
+};
+
+// Filas con la forma del CSV de /create: pocos departamentos, nombres repetidos, correos unicos
+vector<Row> generate_rows(size_t size, mt19937_64& rng) {
+    static const char* nombres[] = { "JUAN", "MARIA", "JOSE", "ROSA", "LUIS", "CARMEN", "CARLOS", "ANA", "JORGE", "LUZ",
+                                     "PEDRO", "ELENA", "MIGUEL", "JULIA", "CESAR", "SONIA", "VICTOR", "NANCY", "RAUL", "PILAR" };
+    static const char* apellidos[] = { "QUISPE", "FLORES", "SANCHEZ", "RODRIGUEZ", "GARCIA", "ROJAS", "HUAMAN", "MAMANI",
+                                       "CHAVEZ", "TORRES", "RAMOS", "VARGAS", "CASTILLO", "MENDOZA", "RIVERA", "DIAZ" };
+    static const char* departamentos[] = { "AMAZONAS", "ANCASH", "APURIMAC", "AREQUIPA", "AYACUCHO", "CAJAMARCA", "CALLAO",
+                                           "CUSCO", "HUANCAVELICA", "HUANUCO", "ICA", "JUNIN", "LA LIBERTAD", "LAMBAYEQUE",
+                                           "LIMA", "LORETO", "MADRE DE DIOS", "MOQUEGUA", "PASCO", "PIURA", "PUNO",
+                                           "SAN MARTIN", "TACNA", "TUMBES", "UCAYALI" };
+    auto pick = [&rng](size_t count) { return static_cast<size_t>(rng() % count); };
+
+    if (size > 29000000) {
+        cerr << "Tamaño maximo: 29000000 registros" << endl;
+        size = 29000000;
+    }
+    vector<uint32_t> order(size);
+    for (size_t i = 0; i < size; i++)
+        order[i] = 10000000 + i * 3;
+    shuffle(order.begin(), order.end(), rng);
+
+    vector<Row> rows(size);
+    for (size_t i = 0; i < size; i++) {
+        Row& row = rows[i];
+        row.dni = to_string(order[i]);
+        string nombre = nombres[pick(20)];
+        string apellido = apellidos[pick(16)];
+        row.fields[0] = nombre + " " + nombres[pick(20)];
+        row.fields[1] = apellido + " " + apellidos[pick(16)];
+        size_t dep = pick(25);
+        row.fields[2] = departamentos[pick(25)];
+        row.fields[3] = departamentos[dep];
+        row.fields[4] = "PROVINCIA " + to_string(dep * 8 + pick(8));
+        row.fields[5] = "CIUDAD " + to_string(dep * 64 + pick(64));
+        row.fields[6] = "DISTRITO " + to_string(dep * 64 + pick(64));
+        row.fields[7] = "CALLE " + to_string(pick(2000)) + " " + to_string(pick(999));
+        row.fields[8] = nombre + "." + apellido + to_string(order[i] % 100000) + "@correo.pe";
+        for (char& c : row.fields[8])
+            c = tolower(c);
+    }
+    return rows;
+}
+
+string rows_to_csv(const vector<Row>& rows) {
+    string csv;
+    for (const Row& row : rows) {
+        csv += row.dni;
+        for (const string& field : row.fields) {
+            csv += ',';
+            csv += field;
+        }
+        csv += '\n';
+    }
+    return csv;
+}
+
+Ciudadano* make_citizen(Btree& tree, const Row& row) {
+    const string* f = row.fields;
+    Direccion direccion = { tree.get_pool_index(f[3]), tree.get_pool_index(f[4]), tree.get_pool_index(f[5]), tree.get_pool_index(f[6]), tree.get_pool_index(f[7]) };
+    return new Ciudadano(row.dni.c_str(), tree.get_pool_index(f[0]), tree.get_pool_index(f[1]), tree.get_pool_index(f[2]), direccion, 987654321, tree.get_pool_index(f[8]), "PE", 0, 0);
+}
+
+Btree* build_tree(int degree, const vector<Row>& rows) {
+    Btree* tree = new Btree(degree);
+    for (const Row& row : rows)
+        tree->insert(make_citizen(*tree, row));
+    return tree;
+}
+
+class Runner {
+public:
+    explicit Runner(const Options& options) : options(options) {}
+
+    bool enabled(const string& name) const {
+        return options.filter.empty() || name.find(options.filter) != string::npos;
+    }
+
+    // body prepara los datos, mide solo lo que esta entre timer.start() y timer.stop() y devuelve las operaciones
+    void run(const string& name, size_t size, int degree, const function<size_t(Timer&)>& body, uint64_t bytes = 0, uint64_t compressed_bytes = 0) {
+        if (!enabled(name))
+            return;
+        Result result{ name, size, degree, 0, {}, bytes, compressed_bytes };
+        for (int rep = 0; rep < options.warmup + options.reps; rep++) {
+            Timer timer;
+            size_t ops = body(timer);
+            if (rep < options.warmup || ops == 0)
+                continue;
+            result.ops = ops;
+            result.ns_per_op.push_back(timer.elapsed_ns / ops);
+        }
+        if (result.ns_per_op.empty())
+            return;
+        vector<double> sorted = result.ns_per_op;
+        sort(sorted.begin(), sorted.end());
+        cerr << "  " << name << " n=" << size << " t=" << degree << ": " << sorted[sorted.size() / 2] << " ns/op (mediana de " << sorted.size() << ")" << endl;
+        results.push_back(move(result));
+    }
+
+    const vector<Result>& getResults() const { return results; }
+
+private:
+    const Options& options;
+    vector<Result> results;
+};
+
+struct Stats {
+    double min, median, mean, max, stddev;
+};
+
+Stats compute_stats(vector<double> samples) {
+    sort(samples.begin(), samples.end());
+    Stats stats;
+    stats.min = samples.front();
+    stats.max = samples.back();
+    size_t mid = samples.size() / 2;
+    stats.median = samples.size() % 2 ? samples[mid] : (samples[mid - 1] + samples[mid]) / 2;
+    double sum = 0;
+    for (double sample : samples)
+        sum += sample;
+    stats.mean = sum / samples.size();
+    double variance = 0;
+    for (double sample : samples)
+        variance += (sample - stats.mean) * (sample - stats.mean);
+    stats.stddev = sqrt(variance / samples.size());
+    return stats;
+}
+
+void write_json(ostream& out, const Options& options, const vector<Result>& results) {
+    out << "{\"seed\":" << options.seed << ",\"reps\":" << options.reps << ",\"warmup\":" << options.warmup;
+    out << ",\"avx2\":" << (avx2_key_scan() ? "true" : "false");
+    out << ",\"compiler\":\"" << escape_json(__VERSION__) << "\",\"results\":[";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        Stats s = compute_stats(r.ns_per_op);
+        out << (i ? "," : "") << "\n{\"benchmark\":\"" << r.name << "\",\"size\":" << r.size << ",\"degree\":" << r.degree
+            << ",\"ops\":" << r.ops << ",\"ns_per_op\":{\"min\":" << s.min << ",\"median\":" << s.median << ",\"mean\":" << s.mean
+            << ",\"max\":" << s.max << ",\"stddev\":" << s.stddev << "},\"ops_per_sec\":" << 1e9 / s.median
+            << ",\"bytes\":" << r.bytes << ",\"compressed_bytes\":" << r.compressed_bytes << "}";
+    }
+    out << "\n]}" << endl;
+}
+
+void write_csv(ostream& out, const vector<Result>& results) {
+    out << "benchmark,size,degree,ops,reps,ns_min,ns_median,ns_mean,ns_max,ns_stddev,ops_per_sec,bytes,compressed_bytes\n";
+    for (const Result& r : results) {
+        Stats s = compute_stats(r.ns_per_op);
+        out << r.name << "," << r.size << "," << r.degree << "," << r.ops << "," << r.ns_per_op.size() << "," << s.min << "," << s.median
+            << "," << s.mean << "," << s.max << "," << s.stddev << "," << 1e9 / s.median << "," << r.bytes << "," << r.compressed_bytes << "\n";
+    }
+}
+
+template <class T, class Parse>
+vector<T> parse_list(const string& list, Parse parse) {
+    vector<T> values;
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, ','))
+        if (!item.empty())
+            values.push_back(parse(item));
+    return values;
+}
+
+bool read_file(const string& filename, string& data) {
+    ifstream file(filename, ios::binary);
+    if (!file)
+        return false;
+    data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    return true;
+}
+
+void run_size(Runner& runner, const Options& options, size_t size, mt19937_64& rng) {
+    vector<Row> rows = generate_rows(size, rng);
+    string csv = rows_to_csv(rows);
+    size = rows.size();
+    size_t queries = min(options.queries, size);
+
+    vector<string> hits(queries), misses(queries);
+    for (size_t i = 0; i < queries; i++) {
+        hits[i] = rows[rng() % size].dni;
+        misses[i] = to_string(stoul(rows[rng() % size].dni) + 1);
+    }
+    // Las eliminaciones usan DNIs distintos para que ninguna caiga sobre una lapida
+    vector<string> removals(queries);
+    for (size_t i = 0; i < queries; i++)
+        removals[i] = rows[i * size / queries].dni;
+
+    // Sin depender del grado: interning de las 9 cadenas por fila y parseo del CSV
+    runner.run("get_pool_index", size, 0, [&](Timer& timer) {
+        Btree tree(16);
+        timer.start();
+        for (const Row& row : rows)
+            for (const string& field : row.fields)
+                tree.get_pool_index(field);
+        timer.stop();
+        return rows.size() * 9;
+    });
+
+    for (int degree : options.degrees) {
+        runner.run("csv_parse", size, degree, [&](Timer& timer) {
+            Btree tree(degree);
+            timer.start();
+            size_t inserted = BTreeManager::loadBuffer(csv.data(), csv.size(), tree);
+            timer.stop();
+            return inserted;
+        });
+
+        runner.run("insert", size, degree, [&](Timer& timer) {
+            Btree tree(degree);
+            vector<Ciudadano*> citizens;
+            citizens.reserve(rows.size());
+            for (const Row& row : rows)
+                citizens.push_back(make_citizen(tree, row));
+            timer.start();
+            for (Ciudadano* citizen : citizens)
+                tree.insert(citizen);
+            timer.stop();
+            return citizens.size();
+        });
+
+        for (const char* name : { "remove", "purge" }) {
+            bool lazy = string(name) == "remove";
+            runner.run(name, size, degree, [&](Timer& timer) {
+                unique_ptr<Btree> tree(build_tree(degree, rows));
+                // Solo el marcado: el purgado en segundo plano correria fuera de la medicion
+                if (lazy)
+                    tree->set_purge_threshold(0);
+                timer.start();
+                for (const string& dni : removals) {
+                    if (lazy)
+                        tree->remove(dni);
+                    else
+                        tree->purge(dni);
+                }
+                timer.stop();
+                return removals.size();
+            });
+        }
+
+        bool needs_tree = false;
+        for (const char* name : { "search_hit", "search_miss", "search_render", "serialize", "deserialize", "zstd_compress", "zstd_decompress" })
+            needs_tree = needs_tree || runner.enabled(name);
+        if (!needs_tree)
+            continue;
+
+        unique_ptr<Btree> tree(build_tree(degree, rows));
+
+        for (const char* name : { "search_hit", "search_miss" }) {
+            const vector<string>& dnis = string(name) == "search_hit" ? hits : misses;
+            runner.run(name, size, degree, [&](Timer& timer) {
+                size_t found = 0;
+                timer.start();
+                for (const string& dni : dnis)
+                    found += tree->search(dni).has_value();
+                timer.stop();
+                sink = found;
+                return dnis.size();
+            });
+        }
+
+        runner.run("search_render", size, degree, [&](Timer& timer) {
+            size_t total = 0;
+            timer.start();
+            for (const string& dni : hits)
+                total += BTreeManager::searchDNI(*tree, dni).size();
+            timer.stop();
+            sink = total;
+            return hits.size();
+        });
+
+        string path = options.tmpdir + "/benchmark_" + to_string(getpid()) + ".bin";
+        tree->serialize(path);
+        string compressed;
+        read_file(path, compressed);
+        string raw(ZSTD_getFrameContentSize(compressed.data(), compressed.size()), '\0');
+        ZSTD_decompress(&raw[0], raw.size(), compressed.data(), compressed.size());
+
+        runner.run("serialize", size, degree, [&](Timer& timer) {
+            timer.start();
+            bool ok = tree->serialize(path);
+            timer.stop();
+            return ok ? size : 0;
+        }, raw.size(), compressed.size());
+
+        runner.run("deserialize", size, degree, [&](Timer& timer) {
+            Btree loaded(degree);
+            timer.start();
+            bool ok = loaded.deserialize(path);
+            timer.stop();
+            return ok ? size : 0;
+        }, raw.size(), compressed.size());
+
+        // Solo la compresion del snapshot, con el mismo nivel que /save
+        runner.run("zstd_compress", size, degree, [&](Timer& timer) {
+            vector<char> output(ZSTD_compressBound(raw.size()));
+            timer.start();
+            size_t written = ZSTD_compress(output.data(), output.size(), raw.data(), raw.size(), Btree::SNAPSHOT_ZSTD_LEVEL);
+            timer.stop();
+            return ZSTD_isError(written) ? 0 : size;
+        }, raw.size(), compressed.size());
+
+        runner.run("zstd_decompress", size, degree, [&](Timer& timer) {
+            vector<char> output(raw.size());
+            timer.start();
+            size_t written = ZSTD_decompress(output.data(), output.size(), compressed.data(), compressed.size());
+            timer.stop();
+            return ZSTD_isError(written) ? 0 : size;
+        }, raw.size(), compressed.size());
+
+        remove(path.c_str());
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto value = [&arg](const string& flag) -> optional<string> {
+            if (arg.compare(0, flag.size(), flag) == 0)
+                return arg.substr(flag.size());
+            return nullopt;
+        };
+        if (auto v = value("--sizes="))
+            options.sizes = parse_list<size_t>(*v, [](const string& s) { return static_cast<size_t>(stoull(s)); });
+        else if (auto v = value("--degrees="))
+            options.degrees = parse_list<int>(*v, [](const string& s) { return stoi(s); });
+        else if (auto v = value("--reps="))
+            options.reps = max(1, stoi(*v));
+        else if (auto v = value("--warmup="))
+            options.warmup = max(0, stoi(*v));
+        else if (auto v = value("--queries="))
+            options.queries = stoull(*v);
+        else if (auto v = value("--seed="))
+            options.seed = stoull(*v);
+        else if (auto v = value("--filter="))
+            options.filter = *v;
+        else if (auto v = value("--format="))
+            options.format = *v;
+        else if (auto v = value("--out="))
+            options.out = *v;
+        else if (auto v = value("--tmpdir="))
+            options.tmpdir = *v;
+        else {
+            cerr << "Uso: " << argv[0] << " [--sizes=10000,100000] [--degrees=16,256,33000] [--reps=5] [--warmup=1]"
+                 << " [--queries=100000] [--seed=42] [--filter=nombre] [--format=json|csv] [--out=archivo] [--tmpdir=/tmp]" << endl;
+            return 1;
+        }
+    }
+    for (int degree : options.degrees) {
+        if (degree < 2) {
+            cerr << "Grado invalido: " << degree << endl;
+            return 1;
+        }
+    }
+
+    NullBuffer null_buffer;
+    streambuf* stdout_buffer = cout.rdbuf(&null_buffer);
+
+    Runner runner(options);
+    mt19937_64 rng(options.seed);
+    for (size_t size : options.sizes) {
+        cerr << "Registros: " << size << endl;
+        run_size(runner, options, size, rng);
+    }
+
+    cout.rdbuf(stdout_buffer);
+    ofstream file;
+    if (!options.out.empty()) {
+        file.open(options.out);
+        if (!file) {
+            cerr << "Error: No se pudo abrir " << options.out << endl;
+            return 1;
+        }
+    }
+    ostream& out = options.out.empty() ? cout : file;
+    if (options.format == "csv")
+        write_csv(out, runner.getResults());
+    else
+        write_json(out, options, runner.getResults());
+    return 0;
+}
@@ -0,0 +1,2566 @@
+#include "btree.h"
+
+#include <chrono>
+#include <iterator>
+#include <cstdio>
+#include <filesystem>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Codigo de 32 bits que conserva el orden de std::string. Un DNI de 8 digitos v tiene el codigo par
+// 2v+2, unico; cualquier otra cadena el impar 2f+3, donde f es el mayor DNI de 8 digitos menor que
+// ella (-1 si no hay), asi queda entre sus dos vecinos numericos. Los impares se desempatan por cadena.
+static uint32_t dni_code(const string& dni) {
+    int64_t value = 0;
+    for (size_t i = 0; i < 8; i++) {
+        int64_t scale = 1;
+        for (size_t j = i; j < 8; j++)
+            scale *= 10;
+        // std::string compara los caracteres como unsigned char
+        unsigned char c = i < dni.size() ? dni[i] : 0;
+        if (i == dni.size() || c < '0')
+            return static_cast<uint32_t>(2 * (value * scale - 1) + 3);
+        if (c > '9')
+            return static_cast<uint32_t>(2 * (value * scale + scale - 1) + 3);
+        value = value * 10 + (c - '0');
+    }
+    return static_cast<uint32_t>(dni.size() == 8 ? 2 * value + 2 : 2 * value + 3);
+}
+
+#ifdef __x86_64__
+// Se compila para AVX2 aunque el resto del binario no; solo se llama si la CPU lo soporta.
+// Los codigos son menores que 2^31, la comparacion con signo sirve sin ajustes.
+__attribute__((target("avx2")))
+static int count_below_avx2(const uint32_t* codes, int size, uint32_t code) {
+    const __m256i query = _mm256_set1_epi32(static_cast<int>(code));
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes + i));
+        count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(query, block))));
+    }
+    for (; i < size; i++)
+        count += codes[i] < code;
+    return count;
+}
+
+static bool detect_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static const bool HAS_AVX2 = detect_avx2();
+#else
+static const bool HAS_AVX2 = false;
+#endif
+
+bool avx2_key_scan() {
+    return HAS_AVX2;
+}
+
+BTreeNode::BTreeNode(int t, bool leaf) : t(t), n(0), leaf(leaf) {
+    keys.resize(2 * t - 1);
+    codes.resize(2 * t - 1);
+    children.resize(2 * t);
+}
+
+void BTreeNode::traverse() const {
+    int i;
+    for (i = 0; i < n; i++) {
+        if (!leaf)
+            children[i]->traverse();
+        cout << keys[i]->getDni() << endl;
+    }
+    if (!leaf)
+        children[i]->traverse();
+}
+
+// Cantidad de claves con codigo menor que code. Busqueda binaria hasta una ventana pequeña
+// y luego conteo vectorizado sobre el bloque contiguo de codigos.
+int BTreeNode::countBelow(uint32_t code) const {
+    int lo = 0, hi = n;
+    while (hi - lo > KEY_SCAN_WINDOW) {
+        int mid = (lo + hi) / 2;
+        if (codes[mid] < code)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+#ifdef __x86_64__
+    if (HAS_AVX2)
+        return lo + count_below_avx2(&codes[lo], hi - lo, code);
+#endif
+    int count = 0;
+    for (int i = lo; i < hi; i++)
+        count += codes[i] < code;
+    return lo + count;
+}
+
+// Cantidad de claves menores que dni (o menores o iguales si inclusive) con el orden de std::string
+int BTreeNode::rank(const string& dni, bool inclusive) const {
+    uint32_t code = dni_code(dni);
+    int i = countBelow(code);
+    for (; i < n && codes[i] == code; i++) {
+        int cmp = code % 2 == 0 ? 0 : keys[i]->getDni().compare(dni);
+        if (cmp > 0 || (cmp == 0 && !inclusive))
+            break;
+    }
+    return i;
+}
+
+// Indice de la primera clave >= dni
+int BTreeNode::lowerBound(const string& dni) const {
+    return rank(dni, false);
+}
+
+bool BTreeNode::matches(int i, const string& dni) const {
+    return i >= 0 && i < n && codes[i] == dni_code(dni) && (codes[i] % 2 == 0 || keys[i]->getDni() == dni);
+}
+
+// Devuelve el registro existente con el mismo DNI en lugar de insertar un duplicado
+Ciudadano* BTreeNode::insertNonFull(Ciudadano* citizen) {
+    string dni = citizen->getDni();
+    int i = rank(dni, true) - 1;
+
+    if (matches(i, dni))
+        return keys[i];
+
+    if (leaf) {
+        for (int j = n - 1; j > i; j--) {
+            keys[j + 1] = keys[j];
+            codes[j + 1] = codes[j];
+        }
+        keys[i + 1] = citizen;
+        codes[i + 1] = dni_code(dni);
+        n++;
+        return nullptr;
+    } else {
+        if (children[i + 1]->n == 2 * t - 1) {
+            splitChild(i + 1, children[i + 1]);
+
+            if (matches(i + 1, dni))
+                return keys[i + 1];
+            if (keys[i + 1]->getDni() < dni)
+                i++;
+        }
+        return children[i + 1]->insertNonFull(citizen);
+    }
+}
+
+void BTreeNode::splitChild(int i, BTreeNode* y) {
+    BTreeNode* z = new BTreeNode(y->t, y->leaf);
+    z->n = t - 1;
+
+    for (int j = 0; j < t - 1; j++) {
+        z->keys[j] = y->keys[j + t];
+        z->codes[j] = y->codes[j + t];
+    }
+
+    if (!y->leaf) {
+        for (int j = 0; j < t; j++)
+            z->children[j] = y->children[j + t];
+    }
+
+    y->n = t - 1;
+
+    for (int j = n; j >= i + 1; j--)
+        children[j + 1] = children[j];
+
+    children[i + 1] = z;
+
+    for (int j = n - 1; j >= i; j--) {
+        keys[j + 1] = keys[j];
+        codes[j + 1] = codes[j];
+    }
+
+    keys[i] = y->keys[t - 1];
+    codes[i] = y->codes[t - 1];
+    n++;
+}
+
+Ciudadano* BTreeNode::search(const string& dni) const {
+    int i = lowerBound(dni);
+
+    if (matches(i, dni))
+        return keys[i];
+
+    if (leaf)
+        return nullptr;
+
+    return children[i]->search(dni);
+}
+
+// Devuelve el registro que salio del arbol (el llamador lo libera) o nullptr si no existe
+Ciudadano* BTreeNode::remove(const string& dni) {
+    int idx = lowerBound(dni);
+
+    if (matches(idx, dni)) {
+        if (leaf)
+            return removeFromLeaf(idx);
+        else
+            return removeFromNonLeaf(idx);
+    } else {
+        if (leaf) {
+            cout << "The key " << dni << " does not exist in the tree\n";
+            return nullptr;
+        }
+
+        bool flag = (idx == n);
+
+        if (children[idx]->n < t)
+            fill(idx);
+
+        if (flag && idx > n)
+            return children[idx - 1]->remove(dni);
+        else
+            return children[idx]->remove(dni);
+    }
+}
+
+Ciudadano* BTreeNode::removeFromLeaf(int idx) {
+    Ciudadano* k = keys[idx];
+    for (int i = idx + 1; i < n; ++i) {
+        keys[i - 1] = keys[i];
+        codes[i - 1] = codes[i];
+    }
+    n--;
+    return k;
+}
+
+// El predecesor o sucesor sube al nodo sin copiarse: se mueve el puntero
+Ciudadano* BTreeNode::removeFromNonLeaf(int idx) {
+    Ciudadano* k = keys[idx];
+
+    if (children[idx]->n >= t) {
+        Ciudadano* pred = getPredecessor(idx);
+        keys[idx] = pred;
+        codes[idx] = dni_code(pred->getDni());
+        children[idx]->remove(pred->getDni());
+    } else if (children[idx + 1]->n >= t) {
+        Ciudadano* succ = getSuccessor(idx);
+        keys[idx] = succ;
+        codes[idx] = dni_code(succ->getDni());
+        children[idx + 1]->remove(succ->getDni());
+    } else {
+        merge(idx);
+        return children[idx]->remove(k->getDni());
+    }
+    return k;
+}
+
+Ciudadano* BTreeNode::getPredecessor(int idx) {
+    BTreeNode* cur = children[idx];
+    while (!cur->leaf)
+        cur = cur->children[cur->n];
+    return cur->keys[cur->n - 1];
+}
+
+Ciudadano* BTreeNode::getSuccessor(int idx) {
+    BTreeNode* cur = children[idx + 1];
+    while (!cur->leaf)
+        cur = cur->children[0];
+    return cur->keys[0];
+}
+
+void BTreeNode::fill(int idx) {
+    if (idx != 0 && children[idx - 1]->n >= t)
+        borrowFromPrev(idx);
+    else if (idx != n && children[idx + 1]->n >= t)
+        borrowFromNext(idx);
+    else {
+        if (idx != n)
+            merge(idx);
+        else
+            merge(idx - 1);
+    }
+}
+
+// Pasa count claves del hermano izquierdo al hijo idx a traves del separador
+void BTreeNode::borrowFromPrev(int idx, int count) {
+    BTreeNode* child = children[idx];
+    BTreeNode* sibling = children[idx - 1];
+
+    for (int i = child->n - 1; i >= 0; --i) {
+        child->keys[i + count] = child->keys[i];
+        child->codes[i + count] = child->codes[i];
+    }
+
+    if (!child->leaf) {
+        for (int i = child->n; i >= 0; --i)
+            child->children[i + count] = child->children[i];
+    }
+
+    child->keys[count - 1] = keys[idx - 1];
+    child->codes[count - 1] = codes[idx - 1];
+
+    int first = sibling->n - count + 1;
+    for (int i = 0; i < count - 1; ++i) {
+        child->keys[i] = sibling->keys[first + i];
+        child->codes[i] = sibling->codes[first + i];
+    }
+
+    if (!child->leaf) {
+        for (int i = 0; i < count; ++i)
+            child->children[i] = sibling->children[first + i];
+    }
+
+    keys[idx - 1] = sibling->keys[sibling->n - count];
+    codes[idx - 1] = sibling->codes[sibling->n - count];
+
+    child->n += count;
+    sibling->n -= count;
+}
+
+// Pasa count claves del hermano derecho al hijo idx a traves del separador
+void BTreeNode::borrowFromNext(int idx, int count) {
+    BTreeNode* child = children[idx];
+    BTreeNode* sibling = children[idx + 1];
+
+    child->keys[child->n] = keys[idx];
+    child->codes[child->n] = codes[idx];
+
+    for (int i = 0; i < count - 1; ++i) {
+        child->keys[child->n + 1 + i] = sibling->keys[i];
+        child->codes[child->n + 1 + i] = sibling->codes[i];
+    }
+
+    if (!child->leaf) {
+        for (int i = 0; i < count; ++i)
+            child->children[child->n + 1 + i] = sibling->children[i];
+    }
+
+    keys[idx] = sibling->keys[count - 1];
+    codes[idx] = sibling->codes[count - 1];
+
+    for (int i = count; i < sibling->n; ++i) {
+        sibling->keys[i - count] = sibling->keys[i];
+        sibling->codes[i - count] = sibling->codes[i];
+    }
+
+    if (!sibling->leaf) {
+        for (int i = count; i <= sibling->n; ++i)
+            sibling->children[i - count] = sibling->children[i];
+    }
+
+    child->n += count;
+    sibling->n -= count;
+}
+
+// Une el hijo idx, el separador y el hijo idx + 1; el hijo puede tener menos de t-1 claves
+void BTreeNode::merge(int idx) {
+    BTreeNode* child = children[idx];
+    BTreeNode* sibling = children[idx + 1];
+    int base = child->n;
+
+    child->keys[base] = keys[idx];
+    child->codes[base] = codes[idx];
+
+    for (int i = 0; i < sibling->n; ++i) {
+        child->keys[base + 1 + i] = sibling->keys[i];
+        child->codes[base + 1 + i] = sibling->codes[i];
+    }
+
+    if (!child->leaf) {
+        for (int i = 0; i <= sibling->n; ++i)
+            child->children[base + 1 + i] = sibling->children[i];
+    }
+
+    for (int i = idx + 1; i < n; ++i) {
+        keys[i - 1] = keys[i];
+        codes[i - 1] = codes[i];
+    }
+
+    for (int i = idx + 2; i <= n; ++i)
+        children[i - 1] = children[i];
+
+    child->n += sibling->n + 1;
+    n--;
+
+    delete sibling;
+}
+
+int BTreeNode::dropTombstones() {
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        if (keys[i]->isBorrado()) {
+            delete keys[i];
+            continue;
+        }
+        keys[kept] = keys[i];
+        codes[kept] = codes[i];
+        kept++;
+    }
+    int dropped = n - kept;
+    n = kept;
+    return dropped;
+}
+
+bool BTreeNode::rebalance(int idx) {
+    BTreeNode* child = children[idx];
+    if (child->n >= t - 1)
+        return false;
+
+    // Una fusion deja a lo sumo 2t-1 claves contando el separador
+    if (idx > 0 && children[idx - 1]->n + child->n < 2 * t - 1) {
+        merge(idx - 1);
+        return true;
+    }
+    if (idx < n && child->n + children[idx + 1]->n < 2 * t - 1) {
+        merge(idx);
+        return true;
+    }
+
+    // Ningun hermano entra: el mayor cede la mitad de la diferencia y ambos quedan con al menos t-1
+    if (idx > 0 && (idx == n || children[idx - 1]->n >= children[idx + 1]->n))
+        borrowFromPrev(idx, (children[idx - 1]->n - child->n) / 2);
+    else
+        borrowFromNext(idx, (children[idx + 1]->n - child->n) / 2);
+    return false;
+}
+
+
+// Bloque de claves del snapshot: si todos los DNIs del nodo son 8 digitos se guarda el primero
+// como base y las diferencias consecutivas empaquetadas en width bits; si no, los 8 bytes tal cual.
+const char KEY_BLOCK_PACKED = 0;
+const char KEY_BLOCK_RAW = 1;
+
+static bool is_numeric_dni(const char* dni) {
+    for (int i = 0; i < 8; i++) {
+        if (dni[i] < '0' || dni[i] > '9')
+            return false;
+    }
+    return true;
+}
+
+static uint32_t dni_value(const char* dni) {
+    uint32_t value = 0;
+    for (int i = 0; i < 8; i++)
+        value = value * 10 + (dni[i] - '0');
+    return value;
+}
+
+static void write_key_block(ostringstream& buffer, const char* dnis, int n) {
+    bool numeric = n > 0;
+    for (int i = 0; numeric && i < n; i++) {
+        numeric = is_numeric_dni(dnis + i * 8) && (i == 0 || dni_value(dnis + i * 8) >= dni_value(dnis + (i - 1) * 8));
+    }
+
+    if (!numeric) {
+        buffer.put(KEY_BLOCK_RAW);
+        buffer.write(dnis, n * 8);
+        return;
+    }
+
+    uint32_t base = dni_value(dnis);
+    uint32_t max_delta = 0;
+    for (int i = 1; i < n; i++)
+        max_delta = max(max_delta, dni_value(dnis + i * 8) - dni_value(dnis + (i - 1) * 8));
+    uint8_t width = 0;
+    while (width < 32 && (uint64_t(1) << width) <= max_delta)
+        width++;
+
+    buffer.put(KEY_BLOCK_PACKED);
+    buffer.write(reinterpret_cast<const char*>(&base), sizeof(base));
+    buffer.put(static_cast<char>(width));
+
+    uint64_t bits = 0;
+    int pending = 0;
+    for (int i = 1; i < n; i++) {
+        bits |= uint64_t(dni_value(dnis + i * 8) - dni_value(dnis + (i - 1) * 8)) << pending;
+        pending += width;
+        while (pending >= 8) {
+            buffer.put(static_cast<char>(bits & 0xFF));
+            bits >>= 8;
+            pending -= 8;
+        }
+    }
+    if (pending > 0)
+        buffer.put(static_cast<char>(bits & 0xFF));
+}
+
+// read(char*, size_t) -> bool permite leer tanto de un istringstream como del ZstdReader
+template <class Read>
+static bool read_key_block(Read& read, int n, char* dnis) {
+    char kind;
+    if (!read(&kind, 1))
+        return false;
+    if (kind == KEY_BLOCK_RAW)
+        return read(dnis, n * 8);
+
+    uint32_t base;
+    char width_byte;
+    if (!read(reinterpret_cast<char*>(&base), sizeof(base)) || !read(&width_byte, 1))
+        return false;
+    int width = static_cast<unsigned char>(width_byte);
+
+    vector<char> packed((size_t(max(n - 1, 0)) * width + 7) / 8);
+    if (!read(packed.data(), packed.size()))
+        return false;
+
+    uint64_t bits = 0;
+    int available = 0;
+    size_t pos = 0;
+    uint32_t value = base;
+    uint64_t mask = width == 0 ? 0 : (uint64_t(1) << width) - 1;
+    for (int i = 0; i < n; i++) {
+        if (i > 0) {
+            while (available < width) {
+                bits |= uint64_t(static_cast<unsigned char>(packed[pos++])) << available;
+                available += 8;
+            }
+            value += static_cast<uint32_t>(bits & mask);
+            bits >>= width;
+            available -= width;
+        }
+        uint32_t v = value;
+        for (int d = 7; d >= 0; d--) {
+            dnis[i * 8 + d] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        }
+    }
+    return true;
+}
+
+const char SNAPSHOT_MAGIC[8] = { 'E', 'D', 'A', 'V', 'S', 'N', 'P', '2' };
+const size_t RECORD_BODY_SIZE = Ciudadano::SERIALIZED_SIZE - 8;
+
+void BTreeNode::serialize(ostringstream& buffer) const {
+    buffer.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    buffer.write(reinterpret_cast<const char*>(&leaf), sizeof(leaf));
+
+    // Los DNIs van en el bloque comprimido y cada registro se guarda sin ellos
+    vector<char> records(size_t(n) * Ciudadano::SERIALIZED_SIZE);
+    vector<char> dnis(size_t(n) * 8);
+    for (int i = 0; i < n; i++) {
+        keys[i]->serialize(&records[i * Ciudadano::SERIALIZED_SIZE]);
+        memcpy(&dnis[i * 8], &records[i * Ciudadano::SERIALIZED_SIZE], 8);
+    }
+    write_key_block(buffer, dnis.data(), n);
+    for (int i = 0; i < n; i++)
+        buffer.write(&records[i * Ciudadano::SERIALIZED_SIZE + 8], RECORD_BODY_SIZE);
+
+    if (!leaf) {
+        for (int i = 0; i <= n; i++) {
+            children[i]->serialize(buffer);
+        }
+    }
+}
+
+void BTreeNode::deserialize(istringstream& buffer, bool packed_keys) {
+    buffer.read(reinterpret_cast<char*>(&n), sizeof(n));
+    buffer.read(reinterpret_cast<char*>(&leaf), sizeof(leaf));
+    keys.resize(2 * t - 1);
+    codes.resize(2 * t - 1);
+    children.resize(2 * t);
+
+    if (packed_keys) {
+        auto read = [&buffer](char* data, size_t size) { return bool(buffer.read(data, size)); };
+        vector<char> dnis(size_t(n) * 8);
+        read_key_block(read, n, dnis.data());
+        char record[Ciudadano::SERIALIZED_SIZE];
+        for (int i = 0; i < n; i++) {
+            memcpy(record, &dnis[i * 8], 8);
+            buffer.read(record + 8, RECORD_BODY_SIZE);
+            keys[i] = new Ciudadano(Ciudadano::deserialize(record));
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            keys[i] = new Ciudadano(Ciudadano::deserialize(buffer));
+        }
+    }
+    for (int i = 0; i < n; i++)
+        codes[i] = dni_code(keys[i]->getDni());
+
+    if (!leaf) {
+        for (int i = 0; i <= n; i++) {
+            children[i] = new BTreeNode(t, true);
+            children[i]->deserialize(buffer, packed_keys);
+        }
+    }
+}
+
+void BTreeNode::collectTombstones(vector<string>& dnis) const {
+    for (int i = 0; i < n; i++) {
+        if (!leaf)
+            children[i]->collectTombstones(dnis);
+        if (keys[i]->isBorrado())
+            dnis.push_back(keys[i]->getDni());
+    }
+    if (!leaf)
+        children[n]->collectTombstones(dnis);
+}
+
+optional<Ciudadano> Btree::insert(Ciudadano* citizen) {
+    unique_lock<RwLock> lock(tree_mutex);
+    if (journaling) {
+        string entry(1 + Ciudadano::SERIALIZED_SIZE, JOURNAL_INSERT);
+        citizen->serialize(&entry[1]);
+        journal.push_back(entry);
+    }
+    return insert_unlocked(citizen);
+}
+
+optional<Ciudadano> Btree::insert_unlocked(Ciudadano* citizen) {
+    Ciudadano* existing = nullptr;
+    if (!root) {
+        root = new BTreeNode(t, true);
+        root->keys[0] = citizen;
+        root->codes[0] = dni_code(citizen->getDni());
+        root->n = 1;
+    } else {
+        if (root->n == 2 * t - 1) {
+            BTreeNode* s = new BTreeNode(t, false);
+            s->children[0] = root;
+            s->splitChild(0, root);
+            root = s;
+
+            int i = 0;
+            if (s->keys[0]->getDni() == citizen->getDni())
+                existing = s->keys[0];
+            else {
+                if (s->keys[0]->getDni() < citizen->getDni())
+                    i++;
+                existing = s->children[i]->insertNonFull(citizen);
+            }
+        } else {
+            existing = root->insertNonFull(citizen);
+        }
+    }
+
+    // Un DNI ya presente se actualiza en su lugar; si era una lapida se reutiliza su espacio
+    optional<Ciudadano> replaced;
+    if (existing) {
+        if (existing->isBorrado())
+            tombstones--;
+        else
+            replaced = *existing;
+        *existing = *citizen;
+        delete citizen;
+    }
+    return replaced;
+}
+
+optional<Ciudadano> Btree::search(const string& dni) const {
+    shared_lock<RwLock> lock(tree_mutex);
+    if (!root) {
+        cout << "Tree is empty" << endl;
+        return nullopt;
+    }
+    const Ciudadano* found = root->search(dni);
+    if (!found || found->isBorrado())
+        return nullopt;
+    return *found;
+}
+
+static void pin_thread(thread& worker, const vector<int>& cpus) {
+    if (cpus.empty())
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+        CPU_SET(cpu, &set);
+    pthread_setaffinity_np(worker.native_handle(), sizeof(set), &set);
+}
+
+optional<Ciudadano> Btree::remove(const string& dni) {
+    unique_lock<RwLock> lock(tree_mutex);
+    if (journaling)
+        journal.push_back(string(1, JOURNAL_REMOVE) + dni);
+    return remove_unlocked(dni);
+}
+
+optional<Ciudadano> Btree::remove_unlocked(const string& dni) {
+    if (!root) {
+        cout << "The tree is empty\n";
+        return nullopt;
+    }
+
+    Ciudadano* found = root->search(dni);
+    if (!found || found->isBorrado()) {
+        cout << "The key " << dni << " does not exist in the tree\n";
+        return nullopt;
+    }
+    Ciudadano removed = *found;
+    found->setBorrado(true);
+    tombstones++;
+    purge_queue.push_back(dni);
+
+    if (purge_threshold > 0 && purge_queue.size() >= purge_threshold && !purging) {
+        // El hilo anterior ya solto el lock antes de terminar, el join no bloquea
+        if (purge_thread.joinable())
+            purge_thread.join();
+        purging = true;
+        purge_thread = thread(&Btree::purge_tombstones, this);
+        pin_thread(purge_thread, background_cpus);
+    }
+    return removed;
+}
+
+optional<Ciudadano> Btree::purge(const string& dni) {
+    unique_lock<RwLock> lock(tree_mutex);
+    if (journaling)
+        journal.push_back(string(1, JOURNAL_REMOVE) + dni);
+
+    if (!root) {
+        cout << "The tree is empty\n";
+        return nullopt;
+    }
+    return purge_unlocked(dni);
+}
+
+optional<Ciudadano> Btree::purge_unlocked(const string& dni) {
+    Ciudadano* removed = root->remove(dni);
+    optional<Ciudadano> live;
+    if (removed) {
+        if (removed->isBorrado())
+            tombstones--;
+        else
+            live = *removed;
+        delete removed;
+    }
+
+    if (root->n == 0) {
+        BTreeNode* tmp = root;
+        if (root->leaf)
+            root = nullptr;
+        else
+            root = root->children[0];
+        delete tmp;
+    }
+    return live;
+}
+
+// Quita del arbol las lapidas pendientes. Cada DNI de la cola lleva a su hoja, que se compacta
+// entera en una pasada; el desbalance se corrige una vez por nivel al subir. Las lapidas que
+// quedaron en nodos internos, pocas con t grande, usan la eliminacion clasica
+void Btree::purge_tombstones() {
+    auto start = chrono::high_resolution_clock::now();
+    size_t purged = 0;
+    vector<pair<BTreeNode*, int>> path;
+    while (true) {
+        {
+            unique_lock<RwLock> lock(tree_mutex);
+            for (size_t nodes = 0; nodes < PURGE_BATCH && !purge_queue.empty();) {
+                string dni = purge_queue.back();
+                purge_queue.pop_back();
+
+                path.clear();
+                BTreeNode* node = root;
+                int idx = 0;
+                while (node) {
+                    idx = node->lowerBound(dni);
+                    if (node->matches(idx, dni) || node->leaf)
+                        break;
+                    path.emplace_back(node, idx);
+                    node = node->children[idx];
+                }
+                // La lapida pudo reutilizarse con un /add posterior o caer en una hoja ya compactada
+                if (!node || !node->matches(idx, dni) || !node->keys[idx]->isBorrado())
+                    continue;
+                nodes++;
+
+                if (!node->leaf) {
+                    purge_unlocked(dni);
+                    purged++;
+                    continue;
+                }
+
+                int dropped = node->dropTombstones();
+                tombstones -= dropped;
+                purged += dropped;
+                for (size_t level = path.size(); level > 0; level--) {
+                    if (!path[level - 1].first->rebalance(path[level - 1].second))
+                        break;
+                }
+                if (root->n == 0) {
+                    BTreeNode* tmp = root;
+                    root = root->leaf ? nullptr : root->children[0];
+                    delete tmp;
+                }
+            }
+            if (purge_queue.empty())
+                break;
+        }
+        this_thread::yield();
+    }
+
+    auto end = chrono::high_resolution_clock::now();
+    auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
+    cout << purged << " lapidas purgadas en " << duration.count() << " milisegundos." << endl;
+    purging = false;
+}
+
+static void write_strings(ostream& buffer, const vector<string>& strings) {
+    uint32_t count = strings.size();
+    buffer.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const auto& str : strings) {
+        uint32_t str_size = str.size();
+        buffer.write(reinterpret_cast<const char*>(&str_size), sizeof(str_size));
+        buffer.write(str.data(), str_size);
+    }
+}
+
+static bool read_strings(istream& buffer, vector<string>& strings) {
+    uint32_t count;
+    if (!buffer.read(reinterpret_cast<char*>(&count), sizeof(count)))
+        return false;
+    strings.resize(count);
+    for (auto& str : strings) {
+        uint32_t str_size;
+        if (!buffer.read(reinterpret_cast<char*>(&str_size), sizeof(str_size)))
+            return false;
+        str.resize(str_size);
+        if (!buffer.read(&str[0], str_size))
+            return false;
+    }
+    return true;
+}
+
+uint32_t Btree::serialize_string_pool(ostringstream& buffer) const {
+    shared_lock<RwLock> lock(pool_mutex);
+    write_strings(buffer, pool_strings);
+    return pool_strings.size();
+}
+
+// Identifica el contenido de un snapshot para que los deltas no se apliquen sobre otra base
+static uint64_t snapshot_id(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void Btree::free_node(BTreeNode* node) {
+    if (!node)
+        return;
+    for (int i = 0; i < node->n; i++)
+        delete node->keys[i];
+    if (!node->leaf)
+        for (int i = 0; i <= node->n; i++)
+            free_node(node->children[i]);
+    delete node;
+}
+
+void Btree::collect_stats(const BTreeNode* node, TreeStats& stats) {
+    stats.nodes++;
+    stats.keys += node->n;
+    if (!node->leaf)
+        for (int i = 0; i <= node->n; i++)
+            collect_stats(node->children[i], stats);
+}
+
+TreeStats Btree::stats() const {
+    shared_lock<RwLock> lock(tree_mutex);
+    TreeStats stats;
+    stats.degree = t;
+    for (const BTreeNode* node = root; node; node = node->leaf ? nullptr : node->children[0])
+        stats.height++;
+    if (root)
+        collect_stats(root, stats);
+    stats.tombstones = tombstones;
+    stats.pool_entries = pool_size();
+    stats.pool_bytes = pool_bytes;
+    return stats;
+}
+
+bool Btree::serialize(const string& filename, uint64_t* base_id) const {
+    shared_lock<RwLock> lock(tree_mutex);
+    return write_snapshot(filename, base_id, nullptr);
+}
+
+bool Btree::write_snapshot(const string& filename, uint64_t* base_id, uint32_t* pool_entries, StageTimer* timer) const {
+    ostringstream buffer;
+    if (root) {
+        auto start = chrono::high_resolution_clock::now();
+        buffer.write(SNAPSHOT_MAGIC, 8);
+        root->serialize(buffer);
+        uint32_t written = serialize_string_pool(buffer);
+        if (pool_entries)
+            *pool_entries = written;
+        auto end = chrono::high_resolution_clock::now();
+        auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
+        cout << "B-Tree serializado en buffer en " << duration.count() << " milisegundos." << endl;
+        if (timer)
+            timer->mark("serialize");
+
+        string uncompressed_data = buffer.str();
+        size_t compressed_size = ZSTD_compressBound(uncompressed_data.size());
+        vector<char> compressed_data(compressed_size);
+        size_t actual_compressed_size = ZSTD_compress(compressed_data.data(), compressed_size, uncompressed_data.data(), uncompressed_data.size(), SNAPSHOT_ZSTD_LEVEL);
+        if (timer)
+            timer->mark("compress");
+
+        ofstream file(filename, ios::binary | ios::out);
+        if (file.is_open()) {
+            file.write(compressed_data.data(), actual_compressed_size);
+            file.close();
+            if (timer)
+                timer->mark("write");
+            if (base_id)
+                *base_id = snapshot_id(compressed_data.data(), actual_compressed_size);
+            cout << "B-Tree serializado y comprimido en archivo con exito." << endl;
+            return true;
+        } else {
+            cerr << "Error abriendo archivo para serializacion." << endl;
+            return false;
+        }
+    } else {
+        cerr << "B-Tree está vacío." << endl;
+        return false;
+    }
+}
+
+bool Btree::deserialize(const string& filename, StageTimer* timer) {
+    ifstream file(filename, ios::binary | ios::in);
+    if (file.is_open()) {
+        auto start = chrono::high_resolution_clock::now();
+
+        file.seekg(0, ios::end);
+        size_t file_size = file.tellg();
+        file.seekg(0, ios::beg);
+
+        vector<char> compressed_data(file_size);
+        file.read(compressed_data.data(), file_size);
+        if (timer)
+            timer->mark("read");
+
+        size_t uncompressed_size = ZSTD_getFrameContentSize(compressed_data.data(), compressed_data.size());
+        if (uncompressed_size == ZSTD_CONTENTSIZE_ERROR) {
+            cerr << "Error: No se pudo determinar su tamaño descomprimido" << endl;
+            return false;
+        } else if (uncompressed_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+            cerr << "Error: Peso de archivo original desconocido" << endl;
+            return false;
+        }
+
+        vector<char> uncompressed_data(uncompressed_size);
+        size_t actual_uncompressed_size = ZSTD_decompress(uncompressed_data.data(), uncompressed_size, compressed_data.data(), compressed_data.size());
+        if (ZSTD_isError(actual_uncompressed_size)) {
+            cerr << "Error de descompresion: " << ZSTD_getErrorName(actual_uncompressed_size) << endl;
+            return false;
+        }
+        if (timer)
+            timer->mark("decompress");
+
+        istringstream buffer(string(uncompressed_data.data(), actual_uncompressed_size));
+        // Los snapshots anteriores no tienen cabecera y empiezan directamente con el nodo raiz
+        bool packed_keys = actual_uncompressed_size >= 8 && memcmp(uncompressed_data.data(), SNAPSHOT_MAGIC, 8) == 0;
+        if (packed_keys)
+            buffer.seekg(8);
+        BTreeNode* loaded = new BTreeNode(t, true);
+        loaded->deserialize(buffer, packed_keys);
+        vector<string> dead;
+        loaded->collectTombstones(dead);
+        if (timer)
+            timer->mark("parse");
+        vector<string> strings;
+        if (!read_strings(buffer, strings)) {
+            cerr << "Error: string pool incompleto en " << filename << endl;
+            free_node(loaded);
+            return false;
+        }
+        if (timer)
+            timer->mark("string_pool");
+        file.close();
+
+        // Arbol, pool, deltas y journal cambian juntos: ni un insert ni un get_pool_index
+        // concurrente pueden quedar entre el pool del snapshot y las strings de los deltas
+        BTreeNode* old_root;
+        bool result;
+        {
+            lock_guard<mutex> lock(checkpoint_mutex);
+            unique_lock<RwLock> tree_lock(tree_mutex);
+            unique_lock<RwLock> pool_lock(pool_mutex);
+            old_root = root;
+            root = loaded;
+            tombstones = dead.size();
+            purge_queue = move(dead);
+            size_t bytes = 0;
+            string_pool.clear();
+            for (uint32_t i = 0; i < strings.size(); i++) {
+                string_pool[strings[i]] = i;
+                bytes += strings[i].size();
+            }
+            pool_strings = move(strings);
+            pool_bytes = bytes;
+
+            auto end = chrono::high_resolution_clock::now();
+            auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
+            cout << "B-Tree deserializado en " << duration.count() << " milisegundos." << endl;
+
+            clear_checkpoint();
+            checkpoint_path = filename;
+            checkpoint_base_id = snapshot_id(compressed_data.data(), compressed_data.size());
+            result = load_deltas(filename);
+        }
+        if (timer)
+            timer->mark("deltas");
+        // El arbol anterior ya no es alcanzable; se libera fuera del lock para no frenar las busquedas
+        free_node(old_root);
+        if (timer)
+            timer->mark("free_old");
+        return result;
+    } else {
+        cerr << "Error abriendo archivo para deserializacion." << endl;
+        return false;
+    }
+}
+
+// Delta de un checkpoint incremental: strings nuevas del pool y operaciones desde el checkpoint anterior
+struct DeltaFile {
+    uint64_t base_id = 0;
+    uint32_t first_seq = 0;
+    uint32_t last_seq = 0;
+    uint32_t pool_start = 0;
+    vector<string> strings;
+    vector<string> ops;
+};
+
+const char DELTA_FILE_MAGIC[8] = { 'E', 'D', 'A', 'V', 'D', 'L', 'T', 'A' };
+
+static string delta_path(const string& filename, uint32_t seq) {
+    return filename + ".delta." + to_string(seq);
+}
+
+static bool file_exists(const string& filename) {
+    return ifstream(filename).good();
+}
+
+// Borra todos los <archivo>.delta.*: tras una compactacion la numeracion tiene huecos y un base
+// reescrito con el mismo contenido volveria a validar los deltas viejos que quedaran despues del hueco
+static void remove_deltas(const string& filename) {
+    filesystem::path base(filename);
+    filesystem::path dir = base.has_parent_path() ? base.parent_path() : filesystem::path(".");
+    string prefix = base.filename().string() + ".delta.";
+    vector<filesystem::path> stale;
+    error_code ec;
+    for (const auto& entry : filesystem::directory_iterator(dir, ec)) {
+        string name = entry.path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) == 0)
+            stale.push_back(entry.path());
+    }
+    for (const auto& path : stale)
+        filesystem::remove(path, ec);
+}
+
+static bool write_delta_file(const string& filename, const DeltaFile& delta) {
+    ostringstream buffer;
+    buffer.write(DELTA_FILE_MAGIC, 8);
+    buffer.write(reinterpret_cast<const char*>(&delta.base_id), sizeof(delta.base_id));
+    buffer.write(reinterpret_cast<const char*>(&delta.first_seq), sizeof(delta.first_seq));
+    buffer.write(reinterpret_cast<const char*>(&delta.last_seq), sizeof(delta.last_seq));
+    buffer.write(reinterpret_cast<const char*>(&delta.pool_start), sizeof(delta.pool_start));
+    write_strings(buffer, delta.strings);
+    write_strings(buffer, delta.ops);
+
+    string uncompressed_data = buffer.str();
+    vector<char> compressed_data(ZSTD_compressBound(uncompressed_data.size()));
+    size_t compressed_size = ZSTD_compress(compressed_data.data(), compressed_data.size(), uncompressed_data.data(), uncompressed_data.size(), Btree::SNAPSHOT_ZSTD_LEVEL);
+    if (ZSTD_isError(compressed_size)) {
+        cerr << "Error de compresion: " << ZSTD_getErrorName(compressed_size) << endl;
+        return false;
+    }
+
+    // Se escribe a un temporal y se renombra para no dejar deltas a medias
+    string tmp = filename + ".tmp";
+    ofstream file(tmp, ios::binary | ios::out | ios::trunc);
+    if (!file.is_open()) {
+        cerr << "Error abriendo archivo para checkpoint." << endl;
+        return false;
+    }
+    file.write(compressed_data.data(), compressed_size);
+    file.close();
+    return file.good() && rename(tmp.c_str(), filename.c_str()) == 0;
+}
+
+static bool read_delta_file(const string& filename, DeltaFile& delta) {
+    ifstream file(filename, ios::binary | ios::in);
+    if (!file.is_open())
+        return false;
+    vector<char> compressed_data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    size_t uncompressed_size = ZSTD_getFrameContentSize(compressed_data.data(), compressed_data.size());
+    if (uncompressed_size == ZSTD_CONTENTSIZE_ERROR || uncompressed_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+        cerr << "Error: delta " << filename << " invalido" << endl;
+        return false;
+    }
+    string uncompressed_data(uncompressed_size, '\0');
+    size_t actual_size = ZSTD_decompress(&uncompressed_data[0], uncompressed_size, compressed_data.data(), compressed_data.size());
+    if (ZSTD_isError(actual_size)) {
+        cerr << "Error de descompresion: " << ZSTD_getErrorName(actual_size) << endl;
+        return false;
+    }
+
+    istringstream buffer(uncompressed_data);
+    char magic[8];
+    buffer.read(magic, 8);
+    buffer.read(reinterpret_cast<char*>(&delta.base_id), sizeof(delta.base_id));
+    buffer.read(reinterpret_cast<char*>(&delta.first_seq), sizeof(delta.first_seq));
+    buffer.read(reinterpret_cast<char*>(&delta.last_seq), sizeof(delta.last_seq));
+    buffer.read(reinterpret_cast<char*>(&delta.pool_start), sizeof(delta.pool_start));
+    if (!buffer || memcmp(magic, DELTA_FILE_MAGIC, 8) != 0) {
+        cerr << "Error: delta " << filename << " invalido" << endl;
+        return false;
+    }
+    return read_strings(buffer, delta.strings) && read_strings(buffer, delta.ops);
+}
+
+void Btree::clear_checkpoint() {
+    checkpoint_path.clear();
+    checkpoint_base_id = 0;
+    checkpoint_seq = 0;
+    checkpoint_files = 0;
+    checkpoint_pool_size = 0;
+    journaling = false;
+    journal.clear();
+}
+
+bool Btree::write_delta(const string& filename, StageTimer* timer) {
+    auto start = chrono::high_resolution_clock::now();
+
+    DeltaFile delta;
+    delta.base_id = checkpoint_base_id;
+    delta.first_seq = delta.last_seq = checkpoint_seq + 1;
+    delta.pool_start = checkpoint_pool_size;
+    // get_pool_index no toma tree_mutex: el pool puede crecer mientras se escribe el delta,
+    // lo que entre despues de la copia va en el siguiente
+    uint32_t pool_end;
+    {
+        shared_lock<RwLock> pool_lock(pool_mutex);
+        pool_end = pool_strings.size();
+        delta.strings.assign(pool_strings.begin() + checkpoint_pool_size, pool_strings.begin() + pool_end);
+    }
+    delta.ops = journal;
+    if (timer)
+        timer->mark("journal");
+
+    if (!write_delta_file(delta_path(filename, delta.last_seq), delta))
+        return false;
+    if (timer)
+        timer->mark("compress_write");
+
+    checkpoint_seq = delta.last_seq;
+    checkpoint_files++;
+    checkpoint_pool_size = pool_end;
+    journal.clear();
+
+    auto end = chrono::high_resolution_clock::now();
+    auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
+    cout << "Checkpoint incremental " << checkpoint_seq << " con " << delta.ops.size() << " cambios guardado en " << duration.count() << " milisegundos." << endl;
+    return true;
+}
+
+bool Btree::load_deltas(const string& filename) {
+    uint32_t seq = 1;
+    while (file_exists(delta_path(filename, seq))) {
+        DeltaFile delta;
+        if (!read_delta_file(delta_path(filename, seq), delta))
+            return false;
+        // Deltas de un snapshot anterior o restos de una compactacion interrumpida
+        if (delta.base_id != checkpoint_base_id || delta.first_seq != seq)
+            break;
+        if (delta.pool_start != pool_strings.size()) {
+            cerr << "Error: string pool inconsistente en delta " << seq << endl;
+            return false;
+        }
+        for (const auto& str : delta.strings) {
+            string_pool[str] = pool_strings.size();
+            pool_strings.push_back(str);
+            pool_bytes += str.size();
+        }
+        for (const auto& op : delta.ops) {
+            if (op[0] == JOURNAL_INSERT)
+                insert_unlocked(new Ciudadano(Ciudadano::deserialize(op.data() + 1)));
+            else
+                remove_unlocked(op.substr(1));
+        }
+
+        checkpoint_seq = delta.last_seq;
+        checkpoint_files++;
+        seq = delta.last_seq + 1;
+    }
+
+    if (checkpoint_files > 0)
+        cout << checkpoint_files << " checkpoints incrementales aplicados." << endl;
+    checkpoint_pool_size = pool_strings.size();
+    journaling = true;
+    return true;
+}
+
+void Btree::compact_deltas(string filename, uint64_t base_id, uint32_t last_seq) {
+    {
+        lock_guard<mutex> lock(checkpoint_mutex);
+        if (checkpoint_path == filename && checkpoint_base_id == base_id) {
+            auto start = chrono::high_resolution_clock::now();
+
+            DeltaFile merged;
+            merged.base_id = base_id;
+            merged.first_seq = 1;
+            uint32_t merged_files = 0;
+            bool ok = true;
+            for (uint32_t seq = 1; ok && seq <= last_seq;) {
+                DeltaFile delta;
+                ok = read_delta_file(delta_path(filename, seq), delta) && delta.base_id == base_id && delta.first_seq == seq;
+                if (ok && merged_files == 0)
+                    merged.pool_start = delta.pool_start;
+                ok = ok && delta.pool_start == merged.pool_start + merged.strings.size();
+                if (ok) {
+                    merged.strings.insert(merged.strings.end(), delta.strings.begin(), delta.strings.end());
+                    merged.ops.insert(merged.ops.end(), delta.ops.begin(), delta.ops.end());
+                    merged.last_seq = delta.last_seq;
+                    merged_files++;
+                    seq = delta.last_seq + 1;
+                }
+            }
+
+            if (ok && merged_files > 1 && write_delta_file(delta_path(filename, 1), merged)) {
+                for (uint32_t seq = 2; seq <= merged.last_seq; seq++)
+                    ::remove(delta_path(filename, seq).c_str());
+                checkpoint_files -= merged_files - 1;
+
+                auto end = chrono::high_resolution_clock::now();
+                auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
+                cout << merged_files << " checkpoints incrementales compactados en " << duration.count() << " milisegundos." << endl;
+            } else if (!ok) {
+                cerr << "Error compactando checkpoints incrementales." << endl;
+            }
+        }
+    }
+    compacting = false;
+}
+
+bool Btree::checkpoint(const string& filename, StageTimer* timer) {
+    lock_guard<mutex> lock(checkpoint_mutex);
+    // Con el lock compartido no entran inserts ni removes, el journal queda fijo mientras se escribe
+    shared_lock<RwLock> tree_lock(tree_mutex);
+
+    if (journaling && filename == checkpoint_path) {
+        if (journal.empty() && pool_size() == checkpoint_pool_size) {
+            cout << "Sin cambios desde el ultimo checkpoint." << endl;
+            return true;
+        }
+        if (!write_delta(filename, timer))
+            return false;
+
+        if (checkpoint_files >= COMPACTION_THRESHOLD && !compacting) {
+            // El hilo anterior ya libero el mutex, el join no bloquea
+            if (compaction_thread.joinable())
+                compaction_thread.join();
+            compacting = true;
+            compaction_thread = thread(&Btree::compact_deltas, this, filename, checkpoint_base_id, checkpoint_seq);
+            pin_thread(compaction_thread, background_cpus);
+        }
+        return true;
+    }
+
+    uint64_t base_id;
+    uint32_t pool_entries;
+    if (!write_snapshot(filename, &base_id, &pool_entries, timer))
+        return false;
+
+    remove_deltas(filename);
+
+    clear_checkpoint();
+    checkpoint_path = filename;
+    checkpoint_base_id = base_id;
+    checkpoint_pool_size = pool_entries;
+    journaling = true;
+    return true;
+}
+
+// Compara una clave de 8 bytes guardada en pagina con un DNI, con el mismo orden que std::string
+static int compare_dni(const char* key, const string& dni) {
+    int cmp = memcmp(key, dni.data(), min<size_t>(8, dni.size()));
+    if (cmp != 0)
+        return cmp;
+    return dni.size() > 8 ? -1 : (dni.size() < 8 ? 1 : 0);
+}
+
+struct PageFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t t;
+    uint64_t page_size;
+    uint32_t root;
+    uint32_t page_count;
+    // Solo version 1: el pool iba despues de la ultima pagina
+    uint64_t pool_offset;
+};
+
+const char PAGE_FILE_MAGIC[8] = { 'E', 'D', 'A', 'V', 'P', 'A', 'G', 'E' };
+const uint32_t PAGE_FILE_VERSION = 2;
+const uint64_t PAGE_FILE_DATA_OFFSET = 4096;
+
+static PageFileHeader page_file_header(const PageLayout& layout, uint32_t root, uint32_t page_count) {
+    PageFileHeader header;
+    memcpy(header.magic, PAGE_FILE_MAGIC, 8);
+    header.version = PAGE_FILE_VERSION;
+    header.t = layout.t;
+    header.page_size = layout.page_size;
+    header.root = root;
+    header.page_count = page_count;
+    header.pool_offset = 0;
+    return header;
+}
+
+// El string pool va en <archivo>.pool: las paginas nuevas se agregan al final del archivo de paginas
+static string pool_path(const string& filename) {
+    return filename + ".pool";
+}
+
+struct StringPoolHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t slots;
+    uint64_t text_size;
+};
+
+const char STRING_POOL_MAGIC[8] = { 'E', 'D', 'A', 'V', 'P', 'O', 'O', 'L' };
+const uint32_t STRING_POOL_VERSION = 1;
+
+// Offsets del archivo del pool: header, count + 1 offsets de texto, slots ids + 1 (0 es vacio) y el texto
+static uint64_t string_pool_table_offset(uint32_t count) {
+    return sizeof(StringPoolHeader) + (uint64_t(count) + 1) * sizeof(uint64_t);
+}
+
+static uint64_t string_pool_text_offset(uint32_t count, uint64_t slots) {
+    return string_pool_table_offset(count) + slots * sizeof(uint32_t);
+}
+
+// Tabla hash con al menos el doble de slots que cadenas, en potencia de dos
+static uint64_t string_pool_slots(uint32_t count) {
+    uint64_t slots = 16;
+    while (slots < 2 * uint64_t(count))
+        slots *= 2;
+    return slots;
+}
+
+uint64_t StringPoolFile::hash(string_view str) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : str) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool StringPoolFile::open(const string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(StringPoolHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+    data = static_cast<const char*>(addr);
+    mapped = st.st_size;
+
+    StringPoolHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, STRING_POOL_MAGIC, 8) != 0 || header.version != STRING_POOL_VERSION
+        || string_pool_text_offset(header.count, header.slots) + header.text_size != mapped) {
+        close();
+        return false;
+    }
+    count = header.count;
+    slots = header.slots;
+    offsets = reinterpret_cast<const uint64_t*>(data + sizeof(StringPoolHeader));
+    table = reinterpret_cast<const uint32_t*>(data + string_pool_table_offset(count));
+    text = data + string_pool_text_offset(count, slots);
+    // Los accesos por id y por hash son aleatorios: no leer por adelantado
+    madvise(const_cast<char*>(data), mapped, MADV_RANDOM);
+    return true;
+}
+
+void StringPoolFile::close() {
+    if (data)
+        munmap(const_cast<char*>(data), mapped);
+    data = nullptr;
+    mapped = 0;
+    count = 0;
+    slots = 0;
+    offsets = nullptr;
+    table = nullptr;
+    text = nullptr;
+}
+
+void StringPoolFile::swap(StringPoolFile& other) {
+    std::swap(data, other.data);
+    std::swap(mapped, other.mapped);
+    std::swap(count, other.count);
+    std::swap(slots, other.slots);
+    std::swap(offsets, other.offsets);
+    std::swap(table, other.table);
+    std::swap(text, other.text);
+}
+
+uint32_t StringPoolFile::find(string_view str) const {
+    if (!data)
+        return count;
+    for (uint64_t slot = hash(str) & (slots - 1);; slot = (slot + 1) & (slots - 1)) {
+        uint32_t entry = table[slot];
+        if (entry == 0)
+            return count;
+        if (get(entry - 1) == str)
+            return entry - 1;
+    }
+}
+
+// Escribe el archivo del pool cadena por cadena, sin tener el pool completo en memoria. La tabla hash
+// se llena al final sobre el archivo mapeado y el archivo reemplaza al anterior con un rename
+class StringPoolWriter {
+public:
+    explicit StringPoolWriter(const string& path) : path(path), tmp(path + ".tmp"), fd(-1), count(0), added(0), slots(0), text_size(0), offsets_written(0), ok(true) {}
+    ~StringPoolWriter() {
+        if (fd >= 0) {
+            ::close(fd);
+            unlink(tmp.c_str());
+        }
+    }
+
+    bool begin(uint32_t count) {
+        this->count = count;
+        slots = string_pool_slots(count);
+        fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, string_pool_text_offset(count, slots)) != 0) {
+            cerr << "Error abriendo archivo del string pool." << endl;
+            return false;
+        }
+        return true;
+    }
+
+    void add(string_view str) {
+        if (added == count) {
+            ok = false;
+            return;
+        }
+        pending_offsets.push_back(text_size);
+        pending_text.append(str.data(), str.size());
+        text_size += str.size();
+        added++;
+        if (pending_offsets.size() >= OFFSET_CHUNK || pending_text.size() >= TEXT_CHUNK)
+            writePending();
+    }
+
+    bool finish() {
+        pending_offsets.push_back(text_size);
+        writePending();
+        if (!ok || added != count) {
+            cerr << "Error escribiendo archivo del string pool." << endl;
+            return false;
+        }
+
+        size_t size = string_pool_text_offset(count, slots) + text_size;
+        void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            cerr << "Error mapeando archivo del string pool." << endl;
+            return false;
+        }
+        char* data = static_cast<char*>(addr);
+        const uint64_t* offsets = reinterpret_cast<const uint64_t*>(data + sizeof(StringPoolHeader));
+        uint32_t* table = reinterpret_cast<uint32_t*>(data + string_pool_table_offset(count));
+        const char* text = data + string_pool_text_offset(count, slots);
+        for (uint32_t id = 0; id < count; id++) {
+            string_view str(text + offsets[id], offsets[id + 1] - offsets[id]);
+            uint64_t slot = StringPoolFile::hash(str) & (slots - 1);
+            while (table[slot] != 0)
+                slot = (slot + 1) & (slots - 1);
+            table[slot] = id + 1;
+        }
+        StringPoolHeader header;
+        memcpy(header.magic, STRING_POOL_MAGIC, 8);
+        header.version = STRING_POOL_VERSION;
+        header.count = count;
+        header.slots = slots;
+        header.text_size = text_size;
+        memcpy(data, &header, sizeof(header));
+        bool synced = msync(data, size, MS_SYNC) == 0;
+        munmap(data, size);
+
+        int result = ::close(fd);
+        fd = -1;
+        return synced && result == 0 && rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+private:
+    static constexpr size_t OFFSET_CHUNK = 65536;
+    static constexpr size_t TEXT_CHUNK = 1 << 20;
+
+    void writePending() {
+        ok = ok && write_all(reinterpret_cast<const char*>(pending_offsets.data()), pending_offsets.size() * sizeof(uint64_t),
+                             sizeof(StringPoolHeader) + offsets_written * sizeof(uint64_t));
+        ok = ok && write_all(pending_text.data(), pending_text.size(), string_pool_text_offset(count, slots) + text_size - pending_text.size());
+        offsets_written += pending_offsets.size();
+        pending_offsets.clear();
+        pending_text.clear();
+    }
+
+    bool write_all(const char* buffer, size_t size, uint64_t offset) {
+        while (size > 0) {
+            ssize_t written = pwrite(fd, buffer, size, offset);
+            if (written <= 0)
+                return false;
+            buffer += written;
+            size -= written;
+            offset += written;
+        }
+        return true;
+    }
+
+    string path;
+    string tmp;
+    int fd;
+    uint32_t count;
+    uint32_t added;
+    uint64_t slots;
+    uint64_t text_size;
+    uint64_t offsets_written;
+    bool ok;
+    vector<uint64_t> pending_offsets;
+    string pending_text;
+};
+
+// Pasa al archivo del pool una lista en el formato de los snapshots: cantidad y luego (largo, texto)
+template <class Read>
+static bool write_pool_file(Read& read, const string& filename) {
+    uint32_t count;
+    if (!read(reinterpret_cast<char*>(&count), sizeof(count)))
+        return false;
+    StringPoolWriter writer(pool_path(filename));
+    if (!writer.begin(count))
+        return false;
+    string str;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t str_size;
+        if (!read(reinterpret_cast<char*>(&str_size), sizeof(str_size)))
+            return false;
+        str.resize(str_size);
+        if (str_size > 0 && !read(&str[0], str_size))
+            return false;
+        writer.add(str);
+    }
+    return writer.finish();
+}
+
+bool BufferPool::open(const string& filename, size_t page_size, uint64_t data_offset, size_t capacity_bytes) {
+    close();
+    fd = ::open(filename.c_str(), O_RDWR);
+    if (fd < 0) {
+        cerr << "Error abriendo archivo de paginas." << endl;
+        return false;
+    }
+    this->page_size = page_size;
+    this->data_offset = data_offset;
+
+    // Un insert fija hasta 3 paginas a la vez, se deja margen para las busquedas concurrentes
+    size_t frame_count = max<size_t>(capacity_bytes / page_size, 8);
+    frames.clear();
+    frames.resize(frame_count);
+    for (auto& frame : frames)
+        frame.data.resize(page_size);
+    page_table.clear();
+    hand = 0;
+    hits = misses = evictions = writebacks = 0;
+    return true;
+}
+
+void BufferPool::close() {
+    if (fd < 0)
+        return;
+    flush();
+    ::close(fd);
+    fd = -1;
+    frames.clear();
+    page_table.clear();
+    writing.clear();
+}
+
+bool BufferPool::readAt(char* data, size_t size, uint64_t offset) const {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t r = pread(fd, data + done, size - done, offset + done);
+        if (r <= 0)
+            return false;
+        done += r;
+    }
+    return true;
+}
+
+bool BufferPool::writeAt(const char* data, size_t size, uint64_t offset) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t w = pwrite(fd, data + done, size - done, offset + done);
+        if (w <= 0)
+            return false;
+        done += w;
+    }
+    return true;
+}
+
+size_t BufferPool::findVictim() {
+    // Dos vueltas completas: la primera limpia los bits de referencia
+    for (size_t step = 0; step < 2 * frames.size(); step++) {
+        Frame& frame = frames[hand];
+        size_t current = hand;
+        hand = (hand + 1) % frames.size();
+
+        if (!frame.valid)
+            return current;
+        if (frame.pin_count > 0)
+            continue;
+        if (frame.referenced) {
+            frame.referenced = false;
+            continue;
+        }
+        return current;
+    }
+    return frames.size();
+}
+
+void BufferPool::writeBack(Frame& frame) {
+    if (!writeAt(frame.data.data(), page_size, data_offset + uint64_t(frame.page_id) * page_size))
+        throw runtime_error("Error escribiendo pagina " + to_string(frame.page_id));
+    frame.dirty = false;
+    writebacks++;
+}
+
+char* BufferPool::pin(uint32_t page_id, bool load) {
+    unique_lock<mutex> lock(mtx);
+    while (true) {
+        auto it = page_table.find(page_id);
+        if (it != page_table.end()) {
+            Frame& frame = frames[it->second];
+            if (frame.loading) {
+                io_done.wait(lock);
+                continue;
+            }
+            frame.pin_count++;
+            frame.referenced = true;
+            hits++;
+            return frame.data.data();
+        }
+        if (writing.count(page_id)) {
+            io_done.wait(lock);
+            continue;
+        }
+
+        size_t victim = findVictim();
+        if (victim == frames.size()) {
+            // Todas las paginas estan fijadas: esperar a que otro hilo libere una
+            frame_released.wait(lock);
+            continue;
+        }
+
+        // El marco queda fijado y marcado como cargando; la E/S se hace sin el mutex
+        Frame& frame = frames[victim];
+        bool write_old = frame.valid && frame.dirty;
+        uint32_t old_id = frame.page_id;
+        if (frame.valid) {
+            page_table.erase(old_id);
+            evictions++;
+        }
+        if (write_old)
+            writing.insert(old_id);
+        if (load)
+            misses++;
+        frame.page_id = page_id;
+        frame.valid = true;
+        frame.loading = true;
+        frame.dirty = false;
+        frame.referenced = true;
+        frame.pin_count = 1;
+        page_table[page_id] = victim;
+        lock.unlock();
+
+        bool written = !write_old || writeAt(frame.data.data(), page_size, data_offset + uint64_t(old_id) * page_size);
+        bool ready = written;
+        if (written && load)
+            ready = readAt(frame.data.data(), page_size, data_offset + uint64_t(page_id) * page_size);
+        else if (written)
+            fill(frame.data.begin(), frame.data.end(), 0);
+
+        lock.lock();
+        if (write_old) {
+            writing.erase(old_id);
+            if (written)
+                writebacks++;
+        }
+        frame.loading = false;
+        if (!ready) {
+            page_table.erase(page_id);
+            frame.pin_count = 0;
+            if (!written) {
+                // La pagina desalojada sigue en el marco y vuelve a la tabla sin perder sus cambios
+                frame.page_id = old_id;
+                frame.dirty = true;
+                page_table[old_id] = victim;
+            } else {
+                frame.valid = false;
+            }
+        }
+        io_done.notify_all();
+        if (!ready) {
+            frame_released.notify_one();
+            if (!written)
+                throw runtime_error("Error escribiendo pagina " + to_string(old_id));
+            throw runtime_error("Error leyendo pagina " + to_string(page_id));
+        }
+        frame.dirty = !load;
+        return frame.data.data();
+    }
+}
+
+char* BufferPool::fetch(uint32_t page_id) {
+    return pin(page_id, true);
+}
+
+char* BufferPool::allocate(uint32_t page_id) {
+    return pin(page_id, false);
+}
+
+void BufferPool::unpin(uint32_t page_id, bool dirty) {
+    lock_guard<mutex> lock(mtx);
+    auto it = page_table.find(page_id);
+    if (it == page_table.end())
+        return;
+    Frame& frame = frames[it->second];
+    frame.dirty = frame.dirty || dirty;
+    if (--frame.pin_count == 0)
+        frame_released.notify_one();
+}
+
+bool BufferPool::flush() {
+    lock_guard<mutex> lock(mtx);
+    try {
+        for (auto& frame : frames) {
+            if (frame.valid && frame.dirty)
+                writeBack(frame);
+        }
+    } catch (const std::exception& e) {
+        cerr << e.what() << endl;
+        return false;
+    }
+    return fsync(fd) == 0;
+}
+
+BufferPoolStats BufferPool::stats() const {
+    lock_guard<mutex> lock(mtx);
+    BufferPoolStats stats;
+    stats.frames = frames.size();
+    stats.resident_pages = page_table.size();
+    stats.page_size = page_size;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.evictions = evictions;
+    stats.writebacks = writebacks;
+    return stats;
+}
+
+string BufferPool::stats_json() const {
+    BufferPoolStats stats = this->stats();
+    uint64_t lookups = stats.hits + stats.misses;
+    double hit_ratio = lookups ? static_cast<double>(stats.hits) / lookups : 0.0;
+    string json = "{";
+    json += "\"frames\": " + to_string(stats.frames) + ",";
+    json += "\"resident_pages\": " + to_string(stats.resident_pages) + ",";
+    json += "\"page_size\": " + to_string(stats.page_size) + ",";
+    json += "\"capacity_bytes\": " + to_string(stats.frames * stats.page_size) + ",";
+    json += "\"hits\": " + to_string(stats.hits) + ",";
+    json += "\"misses\": " + to_string(stats.misses) + ",";
+    json += "\"hit_ratio\": " + to_string(hit_ratio) + ",";
+    json += "\"evictions\": " + to_string(stats.evictions) + ",";
+    json += "\"writebacks\": " + to_string(stats.writebacks);
+    json += "}";
+    return json;
+}
+
+// Lector de un archivo .zst por bloques, sin descomprimirlo completo en memoria
+class ZstdReader {
+public:
+    ZstdReader(const string& filename) : file(filename, ios::binary), stream(ZSTD_createDStream()), out_pos(0), out_size(0), finished(false) {
+        ZSTD_initDStream(stream);
+        in_buffer.resize(ZSTD_DStreamInSize());
+        out_buffer.resize(ZSTD_DStreamOutSize());
+        input = { in_buffer.data(), 0, 0 };
+    }
+    ~ZstdReader() { ZSTD_freeDStream(stream); }
+
+    bool isOpen() const { return file.is_open(); }
+
+    bool read(char* data, size_t size) {
+        if (!pending.empty()) {
+            size_t chunk = min(size, pending.size());
+            memcpy(data, pending.data(), chunk);
+            pending.erase(0, chunk);
+            data += chunk;
+            size -= chunk;
+        }
+        while (size > 0) {
+            if (out_pos == out_size && !refill())
+                return false;
+            size_t chunk = min(size, out_size - out_pos);
+            memcpy(data, out_buffer.data() + out_pos, chunk);
+            out_pos += chunk;
+            data += chunk;
+            size -= chunk;
+        }
+        return true;
+    }
+
+    // Devuelve bytes ya leidos para que la siguiente lectura los entregue de nuevo
+    void unread(const char* data, size_t size) {
+        pending.insert(0, data, size);
+    }
+
+private:
+    bool refill() {
+        while (true) {
+            if (input.pos == input.size) {
+                if (finished)
+                    return false;
+                file.read(in_buffer.data(), in_buffer.size());
+                size_t got = file.gcount();
+                if (got == 0) {
+                    finished = true;
+                    return false;
+                }
+                input = { in_buffer.data(), got, 0 };
+            }
+            ZSTD_outBuffer output = { out_buffer.data(), out_buffer.size(), 0 };
+            size_t ret = ZSTD_decompressStream(stream, &output, &input);
+            if (ZSTD_isError(ret)) {
+                cerr << "Error de descompresion: " << ZSTD_getErrorName(ret) << endl;
+                return false;
+            }
+            if (output.pos > 0) {
+                out_pos = 0;
+                out_size = output.pos;
+                return true;
+            }
+        }
+    }
+
+    ifstream file;
+    ZSTD_DStream* stream;
+    vector<char> in_buffer;
+    vector<char> out_buffer;
+    ZSTD_inBuffer input;
+    size_t out_pos;
+    size_t out_size;
+    bool finished;
+    string pending;
+};
+
+bool PagedBtree::writeHeader(ofstream& file, const PageLayout& layout, uint32_t root, uint32_t page_count) {
+    PageFileHeader header = page_file_header(layout, root, page_count);
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    return file.good();
+}
+
+static bool record_deleted(const char* record) {
+    return (record[Ciudadano::SERIALIZED_SIZE - 1] & 0x10) != 0;
+}
+
+// Arma el archivo de paginas de abajo hacia arriba con los registros en orden de DNI. Con el total
+// conocido la forma del arbol queda fija: cada nivel reparte sus claves de forma pareja entre sus nodos
+class PageBuilder {
+public:
+    PageBuilder(const PageLayout& layout, ofstream& file, uint64_t records) : layout(layout), file(file), next_id(0), overflow(false) {
+        uint64_t two_t = 2 * uint64_t(layout.t);
+        uint64_t nodes = (records + 1 + two_t - 1) / two_t;
+        levels.push_back(Level(layout, nodes, records + 1 - nodes));
+        while (nodes > 1) {
+            uint64_t children = nodes;
+            nodes = (children + two_t - 1) / two_t;
+            levels.push_back(Level(layout, nodes, children - nodes));
+        }
+    }
+
+    void add(const char* record) { emit(0, record); }
+
+    bool finish(uint32_t& root, uint32_t& page_count) {
+        for (size_t level = 0; level < levels.size(); level++)
+            close(level);
+        for (const auto& level : levels) {
+            if (overflow || level.node != level.nodes) {
+                cerr << "Error: cantidad de registros distinta a la contada" << endl;
+                return false;
+            }
+        }
+        root = next_id - 1;
+        page_count = next_id;
+        return file.good();
+    }
+
+private:
+    struct Level {
+        Level(const PageLayout& layout, uint64_t nodes, uint64_t keys) : nodes(nodes), keys(keys), node(0), n(0), children(0), page(layout.page_size, 0) {}
+
+        int target() const { return static_cast<int>(keys / nodes + (node < keys % nodes ? 1 : 0)); }
+
+        uint64_t nodes;
+        uint64_t keys;
+        uint64_t node;
+        int n;
+        int children;
+        vector<char> page;
+    };
+
+    // Un nodo completo se cierra y la clave sube como separador al nivel de arriba
+    void emit(size_t level, const char* record) {
+        if (level == levels.size()) {
+            overflow = true;
+            return;
+        }
+        Level& current = levels[level];
+        if (current.n == current.target()) {
+            close(level);
+            emit(level + 1, record);
+            return;
+        }
+        memcpy(layout.key(current.page.data(), current.n++), record, Ciudadano::SERIALIZED_SIZE);
+    }
+
+    void close(size_t level) {
+        Level& current = levels[level];
+        uint32_t id = next_id++;
+        layout.setN(current.page.data(), current.n);
+        layout.setLeaf(current.page.data(), level == 0);
+        file.seekp(PAGE_FILE_DATA_OFFSET + uint64_t(id) * layout.page_size);
+        file.write(current.page.data(), current.page.size());
+
+        fill(current.page.begin(), current.page.end(), 0);
+        current.n = 0;
+        current.children = 0;
+        current.node++;
+        if (level + 1 < levels.size()) {
+            Level& parent = levels[level + 1];
+            layout.setChild(parent.page.data(), parent.children++, id);
+        }
+    }
+
+    const PageLayout& layout;
+    ofstream& file;
+    vector<Level> levels;
+    uint32_t next_id;
+    bool overflow;
+};
+
+bool PagedBtree::build(const Btree& tree, const string& filename, size_t page_size) {
+    shared_lock<RwLock> tree_lock(tree.tree_mutex);
+    if (!tree.root) {
+        cerr << "B-Tree está vacío." << endl;
+        return false;
+    }
+    ofstream file(filename, ios::binary | ios::out | ios::trunc);
+    if (!file.is_open()) {
+        cerr << "Error abriendo archivo de paginas." << endl;
+        return false;
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    PageLayout layout = PageLayout::forPageSize(page_size);
+    uint64_t records = 0;
+    auto count = [&records](const Ciudadano&) {
+        records++;
+        return true;
+    };
+    Btree::visit_node(tree.root, count);
+
+    PageBuilder builder(layout, file, records);
+    char record[Ciudadano::SERIALIZED_SIZE];
+    auto write = [&builder, &record](const Ciudadano& citizen) {
+        citizen.serialize(record);
+        builder.add(record);
+        return true;
+    };
+    Btree::visit_node(tree.root, write);
+    uint32_t root, page_count;
+    if (!builder.finish(root, page_count))
+        return false;
+
+    bool ok;
+    {
+        shared_lock<RwLock> pool_lock(tree.pool_mutex);
+        StringPoolWriter writer(pool_path(filename));
+        ok = writer.begin(tree.pool_strings.size());
+        for (size_t i = 0; ok && i < tree.pool_strings.size(); i++)
+            writer.add(tree.pool_strings[i]);
+        ok = ok && writer.finish();
+    }
+    ok = ok && writeHeader(file, layout, root, page_count);
+    auto end = chrono::high_resolution_clock::now();
+    auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
+    cout << "Archivo de paginas generado en " << duration.count() << " milisegundos (" << page_count << " paginas de " << layout.page_size << " bytes)." << endl;
+    return ok;
+}
+
+static bool read_snapshot_magic(ZstdReader& reader, bool& packed_keys) {
+    char magic[8];
+    if (!reader.read(magic, 8))
+        return false;
+    packed_keys = memcmp(magic, SNAPSHOT_MAGIC, 8) == 0;
+    if (!packed_keys)
+        reader.unread(magic, 8);
+    return true;
+}
+
+// Recorre en orden un nodo del snapshot; sus claves se guardan hasta visitar el hijo que va antes de cada una
+template <class Visit>
+static bool walk_snapshot_node(ZstdReader& reader, bool packed_keys, int max_keys, Visit& visit) {
+    int n;
+    bool leaf;
+    if (!reader.read(reinterpret_cast<char*>(&n), sizeof(n)) || !reader.read(reinterpret_cast<char*>(&leaf), sizeof(leaf)))
+        return false;
+    if (n < 0 || n > max_keys) {
+        cerr << "Error: nodo con " << n << " claves excede el grado del arbol" << endl;
+        return false;
+    }
+
+    vector<char> keys(size_t(n) * Ciudadano::SERIALIZED_SIZE);
+    if (packed_keys) {
+        auto read = [&reader](char* data, size_t size) { return reader.read(data, size); };
+        vector<char> dnis(size_t(n) * 8);
+        if (!read_key_block(read, n, dnis.data()))
+            return false;
+        for (int i = 0; i < n; i++) {
+            memcpy(&keys[i * Ciudadano::SERIALIZED_SIZE], &dnis[i * 8], 8);
+            if (!reader.read(&keys[i * Ciudadano::SERIALIZED_SIZE + 8], RECORD_BODY_SIZE))
+                return false;
+        }
+    } else if (!reader.read(keys.data(), keys.size())) {
+        return false;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (!leaf && !walk_snapshot_node(reader, packed_keys, max_keys, visit))
+            return false;
+        visit(&keys[i * Ciudadano::SERIALIZED_SIZE]);
+    }
+    return leaf || walk_snapshot_node(reader, packed_keys, max_keys, visit);
+}
+
+bool PagedBtree::buildFromSnapshot(const string& snapshot, const string& filename, int t, size_t page_size) {
+    // Dos pasadas por el snapshot: la primera solo cuenta los registros vivos
+    uint64_t records = 0;
+    {
+        ZstdReader reader(snapshot);
+        bool packed_keys;
+        if (!reader.isOpen()) {
+            cerr << "Error abriendo archivo para deserializacion." << endl;
+            return false;
+        }
+        auto count = [&records](const char* record) {
+            if (!record_deleted(record))
+                records++;
+        };
+        if (!read_snapshot_magic(reader, packed_keys) || !walk_snapshot_node(reader, packed_keys, 2 * t - 1, count)) {
+            cerr << "Error convirtiendo snapshot a paginas." << endl;
+            return false;
+        }
+    }
+
+    ofstream file(filename, ios::binary | ios::out | ios::trunc);
+    if (!file.is_open()) {
+        cerr << "Error abriendo archivo de paginas." << endl;
+        return false;
+    }
+
+    auto start = chrono::high_resolution_clock::now();
+    PageLayout layout = PageLayout::forPageSize(page_size);
+    ZstdReader reader(snapshot);
+    bool packed_keys;
+    PageBuilder builder(layout, file, records);
+    auto write = [&builder](const char* record) {
+        if (!record_deleted(record))
+            builder.add(record);
+    };
+    uint32_t root, page_count;
+    if (!read_snapshot_magic(reader, packed_keys) || !walk_snapshot_node(reader, packed_keys, 2 * t - 1, write) || !builder.finish(root, page_count)) {
+        cerr << "Error convirtiendo snapshot a paginas." << endl;
+        return false;
+    }
+
+    // El string pool del snapshot pasa a su archivo a medida que se descomprime
+    auto read = [&reader](char* data, size_t size) { return reader.read(data, size); };
+    bool ok = write_pool_file(read, filename) && writeHeader(file, layout, root, page_count);
+    auto end = chrono::high_resolution_clock::now();
+    auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
+    cout << "Snapshot convertido a paginas en " << duration.count() << " milisegundos (" << page_count << " paginas de " << layout.page_size << " bytes)." << endl;
+    return ok;
+}
+
+bool PagedBtree::open(const string& filename, size_t cache_bytes) {
+    close();
+    ifstream file(filename, ios::binary | ios::in);
+    if (!file.is_open()) {
+        cerr << "Error abriendo archivo de paginas." << endl;
+        return false;
+    }
+
+    PageFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || memcmp(header.magic, PAGE_FILE_MAGIC, 8) != 0 || header.version < 1 || header.version > PAGE_FILE_VERSION) {
+        cerr << "Error: archivo de paginas invalido" << endl;
+        return false;
+    }
+
+    layout = PageLayout(header.t);
+    if (layout.page_size != header.page_size) {
+        cerr << "Error: tamaño de pagina inconsistente" << endl;
+        return false;
+    }
+
+    // La version 1 tenia el pool donde caen las paginas nuevas y las primeras versiones 2 lo guardaban
+    // en el formato de los snapshots: en ambos casos se pasa al archivo del pool antes de abrir
+    bool legacy_pool = header.version == 1;
+    if (header.version == 1) {
+        file.seekg(header.pool_offset);
+    } else {
+        char magic[8] = {};
+        ifstream legacy(pool_path(filename), ios::binary | ios::in);
+        legacy.read(magic, 8);
+        legacy_pool = legacy.is_open() && memcmp(magic, STRING_POOL_MAGIC, 8) != 0;
+        if (legacy_pool) {
+            file.close();
+            file.open(pool_path(filename), ios::binary | ios::in);
+        }
+    }
+    if (legacy_pool) {
+        auto read = [&file](char* data, size_t size) { return static_cast<bool>(file.read(data, size)); };
+        if (!write_pool_file(read, filename)) {
+            cerr << "Error migrando el string pool del archivo de paginas" << endl;
+            return false;
+        }
+    }
+    file.close();
+
+    if (header.version == 1) {
+        PageFileHeader migrated = page_file_header(layout, header.root, header.page_count);
+        fstream page_file(filename, ios::binary | ios::in | ios::out);
+        if (!page_file.write(reinterpret_cast<const char*>(&migrated), sizeof(migrated))) {
+            cerr << "Error migrando el string pool del archivo de paginas" << endl;
+            return false;
+        }
+        page_file.close();
+        if (truncate(filename.c_str(), header.pool_offset) != 0)
+            return false;
+    }
+
+    StringPoolFile strings;
+    if (!strings.open(pool_path(filename))) {
+        cerr << "Error leyendo string pool del archivo de paginas" << endl;
+        return false;
+    }
+    {
+        unique_lock<RwLock> pool_lock(pool_mutex);
+        pool_file.swap(strings);
+        added_index.clear();
+        added_strings.clear();
+    }
+
+    if (!pool.open(filename, layout.page_size, PAGE_FILE_DATA_OFFSET, cache_bytes))
+        return false;
+
+    this->filename = filename;
+    root = header.root;
+    page_count = header.page_count;
+    is_open = true;
+    cout << "Archivo de paginas abierto: " << page_count << " paginas de " << layout.page_size << " bytes." << endl;
+    return true;
+}
+
+bool PagedBtree::flush() {
+    unique_lock<RwLock> lock(tree_mutex);
+    if (!is_open)
+        return false;
+    if (!pool.flush())
+        return false;
+
+    // Solo se reescribe el pool si /add agrego cadenas; las que lleguen mientras tanto quedan para el proximo
+    size_t added;
+    bool ok = true;
+    {
+        shared_lock<RwLock> pool_lock(pool_mutex);
+        added = added_strings.size();
+        if (added > 0) {
+            StringPoolWriter writer(pool_path(filename));
+            ok = writer.begin(pool_file.size() + added);
+            for (uint32_t i = 0; ok && i < pool_file.size(); i++)
+                writer.add(pool_file.get(i));
+            for (size_t i = 0; ok && i < added; i++)
+                writer.add(added_strings[i]);
+            ok = ok && writer.finish();
+        }
+    }
+    if (ok && added > 0) {
+        StringPoolFile strings;
+        ok = strings.open(pool_path(filename));
+        if (ok) {
+            unique_lock<RwLock> pool_lock(pool_mutex);
+            pool_file.swap(strings);
+            for (size_t i = 0; i < added; i++) {
+                added_index.erase(added_strings.front());
+                added_strings.pop_front();
+            }
+        }
+    }
+    PageFileHeader header = page_file_header(layout, root, page_count);
+    return ok && pool.writeAt(reinterpret_cast<const char*>(&header), sizeof(header), 0);
+}
+
+void PagedBtree::close() {
+    if (!is_open)
+        return;
+    flush();
+    unique_lock<RwLock> lock(tree_mutex);
+    pool.close();
+    {
+        unique_lock<RwLock> pool_lock(pool_mutex);
+        pool_file.close();
+        added_index.clear();
+        added_strings.clear();
+    }
+    is_open = false;
+}
+
+optional<Ciudadano> PagedBtree::search(const string& dni) const {
+    shared_lock<RwLock> lock(tree_mutex);
+    if (!is_open)
+        return nullopt;
+
+    uint32_t id = root;
+    while (true) {
+        const char* page = pool.fetch(id);
+        int n = layout.getN(page);
+
+        // Primera clave >= dni, igual que el recorrido lineal de BTreeNode::search
+        int lo = 0, hi = n;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (compare_dni(layout.key(page, mid), dni) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        if (lo < n && compare_dni(layout.key(page, lo), dni) == 0) {
+            Ciudadano found = Ciudadano::deserialize(layout.key(page, lo));
+            pool.unpin(id, false);
+            if (found.isBorrado())
+                return nullopt;
+            return found;
+        }
+        if (layout.isLeaf(page)) {
+            pool.unpin(id, false);
+            return nullopt;
+        }
+
+        uint32_t next = layout.getChild(page, lo);
+        pool.unpin(id, false);
+        id = next;
+    }
+}
+
+void PagedBtree::splitChild(char* x, int i, char* y) {
+    int t = layout.t;
+    uint32_t z_id = page_count++;
+    char* z = pool.allocate(z_id);
+    bool leaf = layout.isLeaf(y);
+    layout.setLeaf(z, leaf);
+    layout.setN(z, t - 1);
+
+    memcpy(layout.key(z, 0), layout.key(y, t), (t - 1) * Ciudadano::SERIALIZED_SIZE);
+    if (!leaf) {
+        for (int j = 0; j < t; j++)
+            layout.setChild(z, j, layout.getChild(y, j + t));
+    }
+    layout.setN(y, t - 1);
+
+    int n = layout.getN(x);
+    for (int j = n; j >= i + 1; j--)
+        layout.setChild(x, j + 1, layout.getChild(x, j));
+    layout.setChild(x, i + 1, z_id);
+
+    memmove(layout.key(x, i + 1), layout.key(x, i), (n - i) * Ciudadano::SERIALIZED_SIZE);
+    memcpy(layout.key(x, i), layout.key(y, t - 1), Ciudadano::SERIALIZED_SIZE);
+    layout.setN(x, n + 1);
+
+    pool.unpin(z_id, true);
+}
+
+void PagedBtree::insertNonFull(uint32_t page_id, const char* record, const string& dni) {
+    uint32_t id = page_id;
+    while (true) {
+        char* page = pool.fetch(id);
+        int n = layout.getN(page);
+
+        // Primera clave > dni; si la anterior es el mismo DNI se actualiza en su lugar
+        int i = n;
+        while (i > 0 && compare_dni(layout.key(page, i - 1), dni) > 0)
+            i--;
+
+        if (i > 0 && compare_dni(layout.key(page, i - 1), dni) == 0) {
+            memcpy(layout.key(page, i - 1), record, Ciudadano::SERIALIZED_SIZE);
+            pool.unpin(id, true);
+            return;
+        }
+
+        if (layout.isLeaf(page)) {
+            memmove(layout.key(page, i + 1), layout.key(page, i), (n - i) * Ciudadano::SERIALIZED_SIZE);
+            memcpy(layout.key(page, i), record, Ciudadano::SERIALIZED_SIZE);
+            layout.setN(page, n + 1);
+            pool.unpin(id, true);
+            return;
+        }
+
+        uint32_t child_id = layout.getChild(page, i);
+        char* child = pool.fetch(child_id);
+        bool split = false;
+        if (layout.getN(child) == 2 * layout.t - 1) {
+            splitChild(page, i, child);
+            split = true;
+            if (compare_dni(layout.key(page, i), dni) == 0) {
+                memcpy(layout.key(page, i), record, Ciudadano::SERIALIZED_SIZE);
+                pool.unpin(child_id, true);
+                pool.unpin(id, true);
+                return;
+            }
+            if (compare_dni(layout.key(page, i), dni) < 0)
+                i++;
+        }
+        uint32_t next = layout.getChild(page, i);
+        pool.unpin(child_id, split);
+        pool.unpin(id, split);
+        id = next;
+    }
+}
+
+void PagedBtree::insert(const Ciudadano& citizen) {
+    unique_lock<RwLock> lock(tree_mutex);
+    if (!is_open)
+        throw runtime_error("No hay archivo de paginas abierto");
+
+    char record[Ciudadano::SERIALIZED_SIZE];
+    citizen.serialize(record);
+    string dni = citizen.getDni();
+
+    char* r = pool.fetch(root);
+    if (layout.getN(r) == 2 * layout.t - 1) {
+        uint32_t s_id = page_count++;
+        char* s = pool.allocate(s_id);
+        layout.setLeaf(s, false);
+        layout.setN(s, 0);
+        layout.setChild(s, 0, root);
+        splitChild(s, 0, r);
+        pool.unpin(root, true);
+
+        root = s_id;
+        if (compare_dni(layout.key(s, 0), dni) == 0) {
+            memcpy(layout.key(s, 0), record, Ciudadano::SERIALIZED_SIZE);
+            pool.unpin(s_id, true);
+            return;
+        }
+
+        int i = 0;
+        if (compare_dni(layout.key(s, 0), dni) < 0)
+            i++;
+        uint32_t child = layout.getChild(s, i);
+        pool.unpin(s_id, true);
+
+        insertNonFull(child, record, dni);
+    } else {
+        pool.unpin(root, false);
+        insertNonFull(root, record, dni);
+    }
+}
+
+bool PagedBtree::remove(const string& dni) {
+    unique_lock<RwLock> lock(tree_mutex);
+    if (!is_open)
+        throw runtime_error("No hay archivo de paginas abierto");
+
+    uint32_t id = root;
+    while (true) {
+        char* page = pool.fetch(id);
+        int n = layout.getN(page);
+
+        int lo = 0, hi = n;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (compare_dni(layout.key(page, mid), dni) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        if (lo < n && compare_dni(layout.key(page, lo), dni) == 0) {
+            char& flags = layout.key(page, lo)[Ciudadano::SERIALIZED_SIZE - 1];
+            bool alive = (flags & 0x10) == 0;
+            flags |= 0x10;
+            pool.unpin(id, alive);
+            return alive;
+        }
+        if (layout.isLeaf(page)) {
+            pool.unpin(id, false);
+            return false;
+        }
+
+        uint32_t next = layout.getChild(page, lo);
+        pool.unpin(id, false);
+        id = next;
+    }
+}
+
+BufferPoolStats PagedBtree::pool_stats() const {
+    shared_lock<RwLock> lock(tree_mutex);
+    return is_open ? pool.stats() : BufferPoolStats();
+}
+
+string PagedBtree::stats_json() const {
+    shared_lock<RwLock> lock(tree_mutex);
+    string json = "{";
+    json += "\"open\": " + string(is_open ? "true" : "false") + ",";
+    json += "\"pages\": " + to_string(page_count) + ",";
+    {
+        shared_lock<RwLock> pool_lock(pool_mutex);
+        json += "\"pool_strings\": " + to_string(pool_file.size()) + ",";
+        json += "\"pool_strings_unsaved\": " + to_string(added_strings.size()) + ",";
+    }
+    json += "\"buffer_pool\": " + (is_open ? pool.stats_json() : string("null"));
+    json += "}";
+    return json;
+}
+
+// Función para eliminar caracteres de control no deseados como \r
+std::string clean_string(const std::string& input) {
+    std::string output;
+    std::remove_copy_if(input.begin(), input.end(), std::back_inserter(output), [](char c) {
+        return c == '\r';  // Puedes agregar más caracteres no deseados aquí si es necesario
+    });
+    return output;
+}
+
+// Función para escapar caracteres en una cadena para JSON
+std::string escape_json(const std::string& input) {
+    std::string cleaned = clean_string(input);
+    std::string output;
+    output.reserve(cleaned.length());
+    for (char c : cleaned) {
+        switch (c) {
+        case '"':  output += "\\\""; break;
+        case '\\': output += "\\\\"; break;
+        case '\b': output += "\\b"; break;
+        case '\f': output += "\\f"; break;
+        case '\n': output += "\\n"; break;
+        case '\r': output += "\\r"; break;
+        case '\t': output += "\\t"; break;
+        default:
+            if ('\x00' <= c && c <= '\x1f') {
+                output += "\\u" + std::to_string(c);
+            } else {
+                output += c;
+            }
+        }
+    }
+    return output;
+}
+
+bool BTreeManager::loadFile(const string& input_filename, Btree& tree, StageTimer* timer) {
+    ifstream input_file(input_filename, ios::binary);
+    if (!input_file) {
+        cerr << "Error: No se pudo abrir el archivo" << endl;
+        return false;
+    }
+
+    vector<char> compressed_data((istreambuf_iterator<char>(input_file)), istreambuf_iterator<char>());
+    input_file.close();
+    if (timer)
+        timer->mark("read");
+
+    size_t uncompressed_size = ZSTD_getFrameContentSize(compressed_data.data(), compressed_data.size());
+    if (uncompressed_size == ZSTD_CONTENTSIZE_ERROR) {
+        cerr << "Error: No se pudo determinar su tamaño descomprimido" << endl;
+        return false;
+    } else if (uncompressed_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+        cerr << "Error: Peso de archivo original desconocido" << endl;
+        return false;
+    }
+
+    vector<char> uncompressed_data(uncompressed_size);
+    size_t actual_uncompressed_size = ZSTD_decompress(uncompressed_data.data(), uncompressed_size, compressed_data.data(), compressed_data.size());
+    if (ZSTD_isError(actual_uncompressed_size)) {
+        cerr << "Error de descompresion: " << ZSTD_getErrorName(actual_uncompressed_size) << endl;
+        return false;
+    }
+    if (timer)
+        timer->mark("decompress");
+
+    // Una carga masiva no se registra como cambios: el siguiente /save sera completo
+    tree.reset_checkpoint();
+
+    auto start_parse = chrono::high_resolution_clock::now();
+
+    loadBuffer(uncompressed_data.data(), actual_uncompressed_size, tree);
+    if (timer)
+        timer->mark("parse_insert");
+
+    auto stop_parse = chrono::high_resolution_clock::now();
+    auto duration = chrono::duration_cast<chrono::milliseconds>(stop_parse - start_parse);
+    cout << "Tiempo de lectura: " << duration.count() / 1000.0 << "s\n";
+    return true;
+}
+
+size_t BTreeManager::loadBuffer(const char* data, size_t size, Btree& tree) {
+    const char* file_data = data;
+    const char* file_end = data + size;
+    size_t inserted = 0;
+
+    while (file_data < file_end) {
+        const char* line_end = std::find(file_data, file_end, '\n');
+        string line(file_data, line_end);
+
+        vector<string> fields;
+        istringstream ss(line);
+        string field;
+        while (getline(ss, field, ',')) {
+            fields.push_back(field);
+        }
+
+        if (fields.size() == 10) {
+            string dni = fields[0];
+            string nombres = fields[1];
+            string apellidos = fields[2];
+            string lugar_nacimiento = fields[3];
+            Direccion direccion = { tree.get_pool_index(fields[4]), tree.get_pool_index(fields[5]), tree.get_pool_index(fields[6]), tree.get_pool_index(fields[7]), tree.get_pool_index(fields[8]) };
+            string correo = fields[9];
+
+            tree.insert(new Ciudadano(dni.c_str(), tree.get_pool_index(nombres), tree.get_pool_index(apellidos), tree.get_pool_index(lugar_nacimiento), direccion, 987654321, tree.get_pool_index(correo), "PE", 0, 0));
+            inserted++;
+        }
+
+        if (line_end == file_end)
+            break;
+        file_data = line_end + 1;
+    }
+    return inserted;
+}
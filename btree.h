@@ -0,0 +1,652 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <optional>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <pthread.h>
+
+
+// Duracion de cada etapa de una operacion larga (/create, /save, /open), para /metrics
+class StageTimer {
+public:
+    StageTimer() : start(std::chrono::steady_clock::now()), last(start) {}
+
+    void mark(const std::string& stage) {
+        auto now = std::chrono::steady_clock::now();
+        stages.emplace_back(stage, std::chrono::duration<double>(now - last).count());
+        last = now;
+    }
+
+    double elapsed() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+    const std::vector<std::pair<std::string, double>>& getStages() const { return stages; }
+
+private:
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point last;
+    std::vector<std::pair<std::string, double>> stages;
+};
+
+// Lock de lectura y escritura que prioriza a los escritores. El rwlock de glibc detras de std::shared_mutex
+// prioriza a los lectores y con /search constante el purgado, /add, /delete o /open pueden esperar sin limite.
+// No es recursivo: un hilo no debe tomarlo compartido dos veces
+class RwLock {
+public:
+    RwLock() {
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+        pthread_rwlock_init(&rwlock, &attr);
+        pthread_rwlockattr_destroy(&attr);
+    }
+    ~RwLock() { pthread_rwlock_destroy(&rwlock); }
+    RwLock(const RwLock&) = delete;
+    RwLock& operator=(const RwLock&) = delete;
+
+    void lock() { pthread_rwlock_wrlock(&rwlock); }
+    bool try_lock() { return pthread_rwlock_trywrlock(&rwlock) == 0; }
+    void unlock() { pthread_rwlock_unlock(&rwlock); }
+    void lock_shared() { pthread_rwlock_rdlock(&rwlock); }
+    bool try_lock_shared() { return pthread_rwlock_tryrdlock(&rwlock) == 0; }
+    void unlock_shared() { pthread_rwlock_unlock(&rwlock); }
+
+private:
+    pthread_rwlock_t rwlock;
+};
+
+struct TreeStats {
+    int degree = 0;
+    int height = 0;
+    size_t nodes = 0;
+    size_t keys = 0;
+    size_t tombstones = 0;
+    size_t pool_entries = 0;
+    size_t pool_bytes = 0;
+};
+
+struct BufferPoolStats {
+    size_t frames = 0;
+    size_t resident_pages = 0;
+    size_t page_size = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t writebacks = 0;
+};
+
+#pragma pack(push, 1)
+
+struct Direccion {
+    uint32_t departamento;
+    uint32_t provincia;
+    uint32_t ciudad;
+    uint32_t distrito;
+    uint32_t ubicacion;
+};
+
+class Ciudadano {
+private:
+    char dni[8];
+    uint32_t nombres;
+    uint32_t apellidos;
+    uint32_t lugar_nacimiento;
+    Direccion direccion;
+    uint64_t telefono;
+    uint32_t correo;
+    char nacionalidad[2];
+    unsigned sexo : 1;
+    unsigned estado_civil : 3;
+    unsigned borrado : 1;
+
+public:
+    Ciudadano(const char* dni, uint32_t nombres, uint32_t apellidos, uint32_t lugar_nacimiento, Direccion direccion, uint64_t telefono, uint32_t correo, const char* nacionalidad, unsigned sexo, unsigned estado_civil)
+        : nombres(nombres), apellidos(apellidos), lugar_nacimiento(lugar_nacimiento), direccion(direccion), telefono(telefono), correo(correo), sexo(sexo), estado_civil(estado_civil), borrado(0)
+    {
+        strncpy(this->dni, dni, 8);
+        strncpy(this->nacionalidad, nacionalidad, 2);
+    }
+
+    std::string getDni() const { return std::string(dni, 8); }
+    uint32_t getNombres() const { return nombres; }
+    uint32_t getApellidos() const { return apellidos; }
+    uint32_t getLugarNacimiento() const { return lugar_nacimiento; }
+    Direccion getDireccion() const { return direccion; }
+    uint64_t getTelefono() const { return telefono; }
+    uint32_t getCorreo() const { return correo; }
+    std::string getNacionalidad() const { return std::string(nacionalidad, 2); }
+    unsigned getSexo() const { return sexo; }
+    unsigned getEstadoCivil() const { return estado_civil; }
+
+    // Lapida de la eliminacion diferida: el registro sigue en el arbol pero no es visible
+    bool isBorrado() const { return borrado; }
+    void setBorrado(bool value) { borrado = value; }
+
+    static constexpr size_t SERIALIZED_SIZE = 55;
+
+    void serialize(char* out) const {
+        memcpy(out, dni, 8);
+        memcpy(out + 8, &nombres, sizeof(nombres));
+        memcpy(out + 12, &apellidos, sizeof(apellidos));
+        memcpy(out + 16, &lugar_nacimiento, sizeof(lugar_nacimiento));
+        memcpy(out + 20, &direccion, sizeof(direccion));
+        memcpy(out + 40, &telefono, sizeof(telefono));
+        memcpy(out + 48, &correo, sizeof(correo));
+        memcpy(out + 52, nacionalidad, 2);
+        out[54] = static_cast<char>((borrado << 4) | (sexo << 3) | estado_civil);
+    }
+
+    void serialize(std::ostringstream& os) const {
+        char buffer[SERIALIZED_SIZE];
+        serialize(buffer);
+        os.write(buffer, SERIALIZED_SIZE);
+    }
+
+    static Ciudadano deserialize(const char* in) {
+        uint32_t nombres, apellidos, lugar_nacimiento, correo;
+        Direccion direccion;
+        uint64_t telefono;
+        memcpy(&nombres, in + 8, sizeof(nombres));
+        memcpy(&apellidos, in + 12, sizeof(apellidos));
+        memcpy(&lugar_nacimiento, in + 16, sizeof(lugar_nacimiento));
+        memcpy(&direccion, in + 20, sizeof(direccion));
+        memcpy(&telefono, in + 40, sizeof(telefono));
+        memcpy(&correo, in + 48, sizeof(correo));
+
+        unsigned sexo = (in[54] >> 3) & 1;
+        unsigned estado_civil = in[54] & 7;
+
+        Ciudadano citizen(in, nombres, apellidos, lugar_nacimiento, direccion, telefono, correo, in + 52, sexo, estado_civil);
+        citizen.setBorrado((in[54] >> 4) & 1);
+        return citizen;
+    }
+
+    static Ciudadano deserialize(std::istringstream& is) {
+        char buffer[SERIALIZED_SIZE];
+        is.read(buffer, SERIALIZED_SIZE);
+        return deserialize(buffer);
+    }
+};
+
+#pragma pack(pop)
+
+class BTreeNode {
+public:
+    BTreeNode(int t, bool leaf);
+
+    void traverse() const;
+    void splitChild(int i, BTreeNode* y);
+    Ciudadano* insertNonFull(Ciudadano* citizen);
+    int countBelow(uint32_t code) const;
+    int rank(const std::string& dni, bool inclusive) const;
+    int lowerBound(const std::string& dni) const;
+    bool matches(int i, const std::string& dni) const;
+    Ciudadano* search(const std::string& dni) const;
+    Ciudadano* remove(const std::string& dni);
+    Ciudadano* removeFromLeaf(int idx);
+    Ciudadano* removeFromNonLeaf(int idx);
+    Ciudadano* getPredecessor(int idx);
+    Ciudadano* getSuccessor(int idx);
+    void fill(int idx);
+    void borrowFromPrev(int idx, int count = 1);
+    void borrowFromNext(int idx, int count = 1);
+    void merge(int idx);
+    // Purgado por lotes: quita todas las lapidas de una hoja en una pasada y devuelve cuantas eran
+    int dropTombstones();
+    // Si el hijo idx quedo con menos de t-1 claves lo fusiona con un hermano o reparte las claves
+    // del hermano mayor; devuelve true si fusiono (este nodo perdio una clave)
+    bool rebalance(int idx);
+    void serialize(std::ostringstream& buffer) const;
+    void deserialize(std::istringstream& buffer, bool packed_keys);
+    void collectTombstones(std::vector<std::string>& dnis) const;
+
+    friend class Btree;
+    friend class PagedBtree;
+
+private:
+    int t;
+    int n;
+    bool leaf;
+    std::vector<Ciudadano*> keys;
+    // Codigos de los DNIs de keys, contiguos para buscar sin desreferenciar los registros
+    std::vector<uint32_t> codes;
+    std::vector<BTreeNode*> children;
+
+    static constexpr int KEY_SCAN_WINDOW = 32;
+};
+
+class Btree {
+public:
+    Btree(int t) : t(t), tombstones(0), checkpoint_base_id(0), checkpoint_seq(0), checkpoint_files(0), checkpoint_pool_size(0), journaling(false) { root = nullptr; }
+    ~Btree() {
+        if (compaction_thread.joinable())
+            compaction_thread.join();
+        if (purge_thread.joinable())
+            purge_thread.join();
+        free_node(root);
+    }
+
+    void traverse() const {
+        if (root)
+            root->traverse();
+    }
+
+    // Devuelve el registro vivo que se reemplazo, si el DNI ya estaba
+    std::optional<Ciudadano> insert(Ciudadano* citizen);
+    std::optional<Ciudadano> search(const std::string& dni) const;
+
+    // Eliminacion diferida: marca una lapida sin tocar la estructura del arbol. Devuelve el registro borrado
+    std::optional<Ciudadano> remove(const std::string& dni);
+    // Eliminacion inmediata con rebalanceo, como el B-Tree clasico
+    std::optional<Ciudadano> purge(const std::string& dni);
+
+    size_t tombstone_count() const { return tombstones; }
+    // Lapidas acumuladas que disparan el purgado en segundo plano; 0 lo desactiva
+    void set_purge_threshold(size_t threshold) {
+        std::unique_lock<RwLock> lock(tree_mutex);
+        purge_threshold = threshold;
+    }
+
+    // CPUs de los hilos de purgado y compactacion de deltas; sin CPUs heredan la afinidad del hilo que los crea,
+    // que para el purgado es un hilo de busqueda. Se fija al arrancar, antes de atender solicitudes
+    void set_background_cpus(const std::vector<int>& cpus) { background_cpus = cpus; }
+
+    bool serialize(const std::string& filename, uint64_t* base_id = nullptr) const;
+    bool deserialize(const std::string& filename, StageTimer* timer = nullptr);
+
+    // Guarda solo los cambios desde el ultimo /save si el archivo base es el mismo
+    bool checkpoint(const std::string& filename, StageTimer* timer = nullptr);
+    void reset_checkpoint() {
+        std::lock_guard<std::mutex> lock(checkpoint_mutex);
+        std::unique_lock<RwLock> tree_lock(tree_mutex);
+        clear_checkpoint();
+    }
+
+    // Devuelve cuantas strings se escribieron
+    uint32_t serialize_string_pool(std::ostringstream& buffer) const;
+
+    std::string get_string_from_pool(uint32_t index) const {
+        std::shared_lock<RwLock> lock(pool_mutex);
+        return pool_strings[index];
+    }
+
+    uint32_t get_pool_index(const std::string& str) {
+        {
+            std::shared_lock<RwLock> lock(pool_mutex);
+            auto it = string_pool.find(str);
+            if (it != string_pool.end())
+                return it->second;
+        }
+        std::unique_lock<RwLock> lock(pool_mutex);
+        auto inserted = string_pool.emplace(str, pool_strings.size());
+        if (inserted.second) {
+            pool_strings.push_back(str);
+            pool_bytes += str.size();
+        }
+        return inserted.first->second;
+    }
+
+    int degree() const { return t; }
+
+    // Recorre los nodos sin tocar los registros; para /metrics
+    TreeStats stats() const;
+
+    size_t pool_size() const {
+        std::shared_lock<RwLock> lock(pool_mutex);
+        return pool_strings.size();
+    }
+
+    // Visita los registros vivos en orden de DNI mientras visit devuelva true
+    template <class Visit>
+    void forEachRecord(Visit visit) const {
+        std::shared_lock<RwLock> lock(tree_mutex);
+        if (root)
+            visit_node(root, visit);
+    }
+
+    friend class PagedBtree;
+
+    static constexpr int SNAPSHOT_ZSTD_LEVEL = 1;
+    static constexpr uint32_t COMPACTION_THRESHOLD = 8;
+    static constexpr size_t PURGE_THRESHOLD = 1024;
+    // Nodos compactados por cada toma del lock exclusivo
+    static constexpr size_t PURGE_BATCH = 8;
+
+private:
+    enum JournalOp : char { JOURNAL_INSERT = 0, JOURNAL_REMOVE = 1 };
+
+    static void free_node(BTreeNode* node);
+    static void collect_stats(const BTreeNode* node, TreeStats& stats);
+
+    template <class Visit>
+    static bool visit_node(const BTreeNode* node, Visit& visit) {
+        for (int i = 0; i < node->n; i++) {
+            if (!node->leaf && !visit_node(node->children[i], visit))
+                return false;
+            if (!node->keys[i]->isBorrado() && !visit(*node->keys[i]))
+                return false;
+        }
+        return node->leaf || visit_node(node->children[node->n], visit);
+    }
+    bool write_snapshot(const std::string& filename, uint64_t* base_id, uint32_t* pool_entries, StageTimer* timer = nullptr) const;
+    std::optional<Ciudadano> insert_unlocked(Ciudadano* citizen);
+    std::optional<Ciudadano> remove_unlocked(const std::string& dni);
+    std::optional<Ciudadano> purge_unlocked(const std::string& dni);
+    void purge_tombstones();
+
+    // Todos bajo checkpoint_mutex y tree_mutex, que excluye a insert/remove mientras cambia el journal;
+    // load_deltas ademas con tree_mutex y pool_mutex exclusivos
+    void clear_checkpoint();
+    bool write_delta(const std::string& filename, StageTimer* timer);
+    bool load_deltas(const std::string& filename);
+    void compact_deltas(std::string filename, uint64_t base_id, uint32_t last_seq);
+
+    BTreeNode* root;
+    int t;
+    std::unordered_map<std::string, uint32_t> string_pool;
+    std::vector<std::string> pool_strings;
+    std::atomic<size_t> pool_bytes{0};
+    // El pool no depende de tree_mutex: /add interna cadenas antes de tomar el lock del arbol
+    mutable RwLock pool_mutex;
+
+    // Busquedas en paralelo; insert, remove y el purgado en segundo plano son exclusivos
+    mutable RwLock tree_mutex;
+    size_t tombstones;
+    size_t purge_threshold = PURGE_THRESHOLD;
+    std::vector<std::string> purge_queue;
+    std::thread purge_thread;
+    std::atomic<bool> purging{false};
+    std::vector<int> background_cpus;
+
+    // Estado del checkpoint incremental: archivo base, deltas escritos y operaciones pendientes
+    std::string checkpoint_path;
+    uint64_t checkpoint_base_id;
+    uint32_t checkpoint_seq;
+    uint32_t checkpoint_files;
+    uint32_t checkpoint_pool_size;
+    bool journaling;
+    std::vector<std::string> journal;
+    std::mutex checkpoint_mutex;
+    std::thread compaction_thread;
+    std::atomic<bool> compacting{false};
+};
+
+// Si countBelow usa AVX2 en esta CPU
+bool avx2_key_scan();
+
+// Disposicion de un nodo dentro de una pagina: n, leaf, 2t-1 registros serializados y 2t ids de hijos
+struct PageLayout {
+    static constexpr size_t HEADER_SIZE = 8;
+
+    int t;
+    size_t children_offset;
+    size_t page_size;
+
+    explicit PageLayout(int t) : t(t) {
+        children_offset = HEADER_SIZE + (2 * t - 1) * Ciudadano::SERIALIZED_SIZE;
+        page_size = ((children_offset + 2 * t * sizeof(uint32_t)) + 4095) / 4096 * 4096;
+    }
+
+    // Mayor grado cuyo nodo entra en una pagina del tamaño pedido (entre 4 y 64 KB)
+    static PageLayout forPageSize(size_t target) {
+        target = std::min<size_t>(std::max<size_t>(target, 4096), 65536);
+        size_t per_key = 2 * Ciudadano::SERIALIZED_SIZE + 2 * sizeof(uint32_t);
+        return PageLayout(static_cast<int>((target - HEADER_SIZE + Ciudadano::SERIALIZED_SIZE) / per_key));
+    }
+
+    int getN(const char* page) const {
+        int n;
+        memcpy(&n, page, sizeof(n));
+        return n;
+    }
+    void setN(char* page, int n) const { memcpy(page, &n, sizeof(n)); }
+    bool isLeaf(const char* page) const { return page[4] != 0; }
+    void setLeaf(char* page, bool leaf) const { page[4] = leaf ? 1 : 0; }
+
+    char* key(char* page, int i) const { return page + HEADER_SIZE + i * Ciudadano::SERIALIZED_SIZE; }
+    const char* key(const char* page, int i) const { return page + HEADER_SIZE + i * Ciudadano::SERIALIZED_SIZE; }
+
+    uint32_t getChild(const char* page, int i) const {
+        uint32_t id;
+        memcpy(&id, page + children_offset + i * sizeof(uint32_t), sizeof(id));
+        return id;
+    }
+    void setChild(char* page, int i, uint32_t id) const { memcpy(page + children_offset + i * sizeof(uint32_t), &id, sizeof(id)); }
+};
+
+// Cache de paginas con capacidad fija en bytes. Reemplazo CLOCK y escritura diferida de paginas sucias.
+class BufferPool {
+public:
+    BufferPool() : fd(-1), page_size(0), data_offset(0), hand(0), hits(0), misses(0), evictions(0), writebacks(0) {}
+    ~BufferPool() { close(); }
+
+    bool open(const std::string& filename, size_t page_size, uint64_t data_offset, size_t capacity_bytes);
+    void close();
+
+    // Devuelve la pagina fijada en memoria; debe liberarse con unpin
+    char* fetch(uint32_t page_id);
+    char* allocate(uint32_t page_id);
+    void unpin(uint32_t page_id, bool dirty);
+    bool flush();
+
+    bool readAt(char* data, size_t size, uint64_t offset) const;
+    bool writeAt(const char* data, size_t size, uint64_t offset);
+
+    BufferPoolStats stats() const;
+    std::string stats_json() const;
+
+private:
+    struct Frame {
+        uint32_t page_id = 0;
+        std::vector<char> data;
+        bool valid = false;
+        bool dirty = false;
+        bool referenced = false;
+        // Reservado por un pin que esta leyendo la pagina fuera del mutex
+        bool loading = false;
+        int pin_count = 0;
+    };
+
+    char* pin(uint32_t page_id, bool load);
+    size_t findVictim();
+    void writeBack(Frame& frame);
+
+    int fd;
+    size_t page_size;
+    uint64_t data_offset;
+    std::vector<Frame> frames;
+    std::unordered_map<uint32_t, size_t> page_table;
+    // Paginas desalojadas cuya escritura sigue en curso; no se pueden volver a leer hasta que termine
+    std::unordered_set<uint32_t> writing;
+    size_t hand;
+    uint64_t hits, misses, evictions, writebacks;
+    mutable std::mutex mtx;
+    std::condition_variable frame_released;
+    std::condition_variable io_done;
+};
+
+// String pool del modo paginado, mapeado con mmap desde <archivo>.pool: tabla de offsets, tabla hash
+// de ids y el texto. El kernel decide que queda residente, asi el pool no crece fuera del presupuesto de RAM
+class StringPoolFile {
+public:
+    StringPoolFile() : data(nullptr), mapped(0), count(0), slots(0), offsets(nullptr), table(nullptr), text(nullptr) {}
+    ~StringPoolFile() { close(); }
+    StringPoolFile(const StringPoolFile&) = delete;
+    StringPoolFile& operator=(const StringPoolFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    void swap(StringPoolFile& other);
+
+    uint32_t size() const { return count; }
+    std::string_view get(uint32_t id) const {
+        return std::string_view(text + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+    // Id de str, o size() si no esta
+    uint32_t find(std::string_view str) const;
+
+    static uint64_t hash(std::string_view str);
+
+private:
+    const char* data;
+    size_t mapped;
+    uint32_t count;
+    uint64_t slots;
+    const uint64_t* offsets;
+    const uint32_t* table;
+    const char* text;
+};
+
+// B-Tree cuyos nodos viven en un archivo de paginas y se cargan bajo demanda a traves del BufferPool
+class PagedBtree {
+public:
+    PagedBtree() : layout(1), root(0), page_count(0), is_open(false) {}
+    ~PagedBtree() { close(); }
+
+    static constexpr size_t DEFAULT_PAGE_SIZE = 16384;
+
+    // El grado de las paginas sale de page_size, no del arbol de origen; t es el grado del snapshot
+    static bool build(const Btree& tree, const std::string& filename, size_t page_size = DEFAULT_PAGE_SIZE);
+    static bool buildFromSnapshot(const std::string& snapshot, const std::string& filename, int t, size_t page_size = DEFAULT_PAGE_SIZE);
+
+    bool open(const std::string& filename, size_t cache_bytes);
+    bool flush();
+    void close();
+    bool isOpen() const { return is_open; }
+
+    std::optional<Ciudadano> search(const std::string& dni) const;
+    void insert(const Ciudadano& citizen);
+    // Solo marca la lapida en la pagina; las paginas no se reorganizan
+    bool remove(const std::string& dni);
+
+    std::string get_string_from_pool(uint32_t index) const {
+        std::shared_lock<RwLock> lock(pool_mutex);
+        if (index < pool_file.size())
+            return std::string(pool_file.get(index));
+        return added_strings[index - pool_file.size()];
+    }
+
+    uint32_t get_pool_index(const std::string& str) {
+        {
+            std::shared_lock<RwLock> lock(pool_mutex);
+            uint32_t index = find_pool_index(str);
+            if (index != UINT32_MAX)
+                return index;
+        }
+        std::unique_lock<RwLock> lock(pool_mutex);
+        uint32_t index = find_pool_index(str);
+        if (index != UINT32_MAX)
+            return index;
+        index = pool_file.size() + added_strings.size();
+        added_strings.push_back(str);
+        added_index.emplace(added_strings.back(), index);
+        return index;
+    }
+
+    BufferPoolStats pool_stats() const;
+    std::string stats_json() const;
+
+private:
+    static bool writeHeader(std::ofstream& file, const PageLayout& layout, uint32_t root, uint32_t page_count);
+
+    void splitChild(char* x, int i, char* y);
+    void insertNonFull(uint32_t page_id, const char* record, const std::string& dni);
+
+    PageLayout layout;
+    std::string filename;
+    uint32_t root;
+    uint32_t page_count;
+    std::atomic<bool> is_open;
+    mutable BufferPool pool;
+    mutable RwLock tree_mutex;
+    mutable RwLock pool_mutex;
+    StringPoolFile pool_file;
+    // Cadenas de /add que aun no estan en el archivo; /savepages las pasa al archivo. deque no mueve
+    // las cadenas al crecer, asi las claves de added_index siguen validas
+    std::deque<std::string> added_strings;
+    std::unordered_map<std::string_view, uint32_t> added_index;
+
+    uint32_t find_pool_index(const std::string& str) const {
+        uint32_t index = pool_file.find(str);
+        if (index != pool_file.size())
+            return index;
+        auto it = added_index.find(str);
+        return it != added_index.end() ? it->second : UINT32_MAX;
+    }
+};
+
+std::string clean_string(const std::string& input);
+std::string escape_json(const std::string& input);
+
+class BTreeManager {
+public:
+    static bool loadFile(const std::string& input_filename, Btree& tree, StageTimer* timer = nullptr);
+    // Inserta las lineas de 10 campos de un CSV ya descomprimido; devuelve cuantas se insertaron
+    static size_t loadBuffer(const char* data, size_t size, Btree& tree);
+
+    // Sirve tanto para el Btree en memoria como para el PagedBtree
+    template <class Tree>
+    static std::string searchDNI(const Tree& tree, const std::string& dniToSearch) {
+        auto found = tree.search(dniToSearch);
+        std::string jsonResult = "{";
+
+        if (found) {
+            jsonResult += "\"DNI\": \"" + escape_json(found->getDni()) + "\",";
+            jsonResult += "\"Nombres\": \"" + escape_json(tree.get_string_from_pool(found->getNombres())) + "\",";
+            jsonResult += "\"Apellidos\": \"" + escape_json(tree.get_string_from_pool(found->getApellidos())) + "\",";
+            jsonResult += "\"Lugar de Nacimiento\": \"" + escape_json(tree.get_string_from_pool(found->getLugarNacimiento())) + "\",";
+            
+            Direccion dir = found->getDireccion();
+            jsonResult += "\"Direccion\": {";
+            jsonResult += "\"Departamento\": \"" + escape_json(tree.get_string_from_pool(dir.departamento)) + "\",";
+            jsonResult += "\"Provincia\": \"" + escape_json(tree.get_string_from_pool(dir.provincia)) + "\",";
+            jsonResult += "\"Ciudad\": \"" + escape_json(tree.get_string_from_pool(dir.ciudad)) + "\",";
+            jsonResult += "\"Distrito\": \"" + escape_json(tree.get_string_from_pool(dir.distrito)) + "\",";
+            jsonResult += "\"Ubicacion\": \"" + escape_json(tree.get_string_from_pool(dir.ubicacion)) + "\"";
+            jsonResult += "},"; // Cierra el objeto Dirección
+            
+            jsonResult += "\"Telefono\": \"" + escape_json(std::to_string(found->getTelefono())) + "\",";
+            jsonResult += "\"Correo\": \"" + escape_json(tree.get_string_from_pool(found->getCorreo())) + "\",";
+            jsonResult += "\"Nacionalidad\": \"" + escape_json(found->getNacionalidad()) + "\",";
+            jsonResult += "\"Sexo\": \"" + escape_json(found->getSexo() == 0 ? "Masculino" : "Femenino") + "\",";
+            jsonResult += "\"Estado Civil\": \"" + escape_json(found->getEstadoCivil() == 0 ? "Soltero" : "Casado") + "\"";
+        } else {
+            jsonResult += "\"error\": \"DNI " + escape_json(dniToSearch) + " no encontrado.\"";
+        }
+
+        jsonResult += "}";
+        return jsonResult;
+    }
+
+    // Construye un Ciudadano a partir de los 14 campos del endpoint /add
+    template <class Tree>
+    static Ciudadano parseCiudadano(Tree& tree, const std::vector<std::string>& fields) {
+        std::string dni = fields[0];
+        uint32_t nombres = tree.get_pool_index(fields[1]);
+        uint32_t apellidos = tree.get_pool_index(fields[2]);
+        uint32_t lugar_nacimiento = tree.get_pool_index(fields[3]);
+        Direccion direccion = { tree.get_pool_index(fields[4]), tree.get_pool_index(fields[5]), tree.get_pool_index(fields[6]), tree.get_pool_index(fields[7]), tree.get_pool_index(fields[8]) };
+        uint64_t telefono = stoull(fields[9]);
+        uint32_t correo = tree.get_pool_index(fields[10]);
+        std::string nacionalidad = fields[11];
+        unsigned sexo = static_cast<unsigned>(stoi(fields[12]));
+        unsigned estado_civil = static_cast<unsigned>(stoi(fields[13]));
+
+        return Ciudadano(dni.c_str(), nombres, apellidos, lugar_nacimiento, direccion, telefono, correo, nacionalidad.c_str(), sexo, estado_civil);
+    }
+};
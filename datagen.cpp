@@ -0,0 +1,624 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <optional>
+#include <charconv>
+#include <cmath>
+#include <zstd.h>
+
+using namespace std;
+
+// Generador de datasets sinteticos para /create, /add y loadgen. Cada registro depende solo de su
+// posicion y de --seed, asi que la salida es identica con cualquier numero de hilos.
+
+enum Format { FORMAT_CREATE = 0, FORMAT_ADD, FORMAT_REPLAY };
+
+struct Options {
+    size_t records = 33000000;
+    string out = "datanew.zst";
+    int threads = max(1u, thread::hardware_concurrency());
+    int zstd_workers = -1;
+    int level = 3;
+    uint64_t seed = 42;
+    Format format = FORMAT_CREATE;
+    bool sorted = false;
+    uint64_t dni_base = 1;
+    double density = 0.4;
+    size_t run = 1000;
+    double duplicates = 0;
+    size_t names = 3000;
+    size_t surnames = 20000;
+    double zipf = 1.0;
+};
+
+static constexpr size_t CHUNK_RECORDS = 1 << 16;
+static constexpr uint64_t MAX_DNI = 99999999;
+
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Valor pseudoaleatorio por (registro, uso), sin estado compartido entre hilos
+static inline uint64_t draw(uint64_t seed, uint64_t index, uint64_t stream) {
+    return mix64(seed ^ mix64(index * 0x9E3779B97F4A7C15ULL + stream));
+}
+
+static inline double unit(uint64_t random) {
+    return (random >> 11) * 0x1.0p-53;
+}
+
+// Distribucion de Zipf sobre rangos 0..size-1 (el rango 0 es el mas frecuente) con el metodo alias:
+// una sola extraccion y un acceso a la tabla por muestra, en vez de una busqueda binaria sobre la CDF
+class ZipfTable {
+public:
+    ZipfTable(size_t size, double exponent) : threshold(max<size_t>(size, 1)), alias(threshold.size()) {
+        size_t count = threshold.size();
+        vector<double> scaled(count);
+        double total = 0;
+        for (size_t rank = 0; rank < count; rank++)
+            total += scaled[rank] = 1.0 / pow(rank + 1.0, exponent);
+        vector<uint32_t> small, large;
+        for (size_t rank = 0; rank < count; rank++) {
+            scaled[rank] *= count / total;
+            (scaled[rank] < 1 ? small : large).push_back(rank);
+        }
+        while (!small.empty() && !large.empty()) {
+            uint32_t low = small.back(), high = large.back();
+            small.pop_back();
+            threshold[low] = static_cast<uint32_t>(min(scaled[low], 1.0) * 4294967295.0);
+            alias[low] = high;
+            scaled[high] -= 1 - scaled[low];
+            if (scaled[high] < 1) {
+                large.pop_back();
+                small.push_back(high);
+            }
+        }
+        // Lo que queda tiene probabilidad 1 salvo error de redondeo
+        for (uint32_t rank : small)
+            threshold[rank] = UINT32_MAX, alias[rank] = rank;
+        for (uint32_t rank : large)
+            threshold[rank] = UINT32_MAX, alias[rank] = rank;
+    }
+
+    size_t pick(uint64_t random) const {
+        size_t column = ((random >> 32) * threshold.size()) >> 32;
+        return static_cast<uint32_t>(random) < threshold[column] ? column : alias[column];
+    }
+
+private:
+    vector<uint32_t> threshold;
+    vector<uint32_t> alias;
+};
+
+// Permutacion pseudoaleatoria de 0..size-1 (red de Feistel con recorrido de ciclos): permite un orden
+// aleatorio sin materializar ni barajar un arreglo de 33M posiciones
+class Permutation {
+public:
+    Permutation(uint64_t size, uint64_t seed) : size(size), seed(seed) {
+        int bits = 0;
+        while (bits < 64 && (1ULL << bits) < size)
+            bits++;
+        half_bits = max(1, (bits + 1) / 2);
+    }
+
+    uint64_t operator()(uint64_t index) const {
+        do {
+            index = encrypt(index);
+        } while (index >= size);
+        return index;
+    }
+
+private:
+    uint64_t encrypt(uint64_t value) const {
+        uint64_t mask = (1ULL << half_bits) - 1;
+        uint64_t left = value >> half_bits, right = value & mask;
+        for (uint64_t round = 0; round < 4; round++) {
+            uint64_t next = left ^ (draw(seed, right, 0x100 + round) & mask);
+            left = right;
+            right = next;
+        }
+        return (left << half_bits) | right;
+    }
+
+    uint64_t size;
+    uint64_t seed;
+    int half_bits;
+};
+
+// Los nombres reales van primero para quedarse con los rangos frecuentes; el resto se arma con silabas
+static vector<string> build_vocabulary(const vector<const char*>& core, size_t count, mt19937_64& rng) {
+    static const char* syllables[] = { "MA", "RI", "LU", "CA", "TA", "QUI", "HUA", "PA", "YU", "CHA", "RO", "SA", "NE", "LO",
+                                       "TU", "VI", "ZA", "MI", "NA", "GA", "BE", "DO", "FE", "LLA", "CU", "SI", "TO", "RA",
+                                       "ME", "PI" };
+    static const char* endings[] = { "", "", "N", "S", "R", "L", "Z" };
+    vector<string> words;
+    unordered_set<string> seen;
+    for (const char* word : core) {
+        if (words.size() == count)
+            break;
+        if (seen.insert(word).second)
+            words.push_back(word);
+    }
+    size_t attempts = 0;
+    while (words.size() < count && attempts++ < count * 20) {
+        string word;
+        size_t length = 2 + rng() % 3;
+        for (size_t i = 0; i < length; i++)
+            word += syllables[rng() % size(syllables)];
+        word += endings[rng() % size(endings)];
+        if (seen.insert(word).second)
+            words.push_back(word);
+    }
+    return words;
+}
+
+static string to_lower(string word) {
+    for (char& c : word)
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    return word;
+}
+
+struct Record {
+    uint64_t dni;
+    uint32_t nombres[2];
+    bool segundo_nombre;
+    uint32_t apellidos[2];
+    uint32_t lugar_nacimiento;
+    uint32_t departamento;
+    uint32_t provincia;
+    uint32_t distrito;
+    uint32_t via;
+    uint32_t calle;
+    uint32_t numero;
+    uint32_t correo_numero;
+    uint32_t dominio;
+    uint64_t telefono;
+    uint32_t nacionalidad;
+    uint32_t sexo;
+    uint32_t estado_civil;
+};
+
+class DatasetGenerator {
+public:
+    static constexpr size_t MAX_SUBDIVISIONS = 24;
+
+    explicit DatasetGenerator(const Options& options)
+        : options(options), order(options.records, options.seed), name_zipf(1, 1), surname_zipf(1, 1),
+          departamento_zipf(size(DEPARTAMENTOS), 1.0), dominio_zipf(size(DOMINIOS), 1.2) {
+        mt19937_64 rng(options.seed);
+        nombres = build_vocabulary({ "JUAN", "MARIA", "JOSE", "ROSA", "LUIS", "CARMEN", "CARLOS", "ANA", "JORGE", "LUZ",
+                                     "PEDRO", "ELENA", "MIGUEL", "JULIA", "CESAR", "SONIA", "VICTOR", "NANCY", "RAUL", "PILAR",
+                                     "ALBERTO", "GLADYS", "MANUEL", "FLOR", "JESUS", "MARTHA", "FERNANDO", "LUCIA", "DANIEL", "SILVIA" },
+                                   options.names, rng);
+        apellidos = build_vocabulary({ "QUISPE", "FLORES", "SANCHEZ", "RODRIGUEZ", "GARCIA", "ROJAS", "HUAMAN", "MAMANI",
+                                       "CHAVEZ", "TORRES", "RAMOS", "VARGAS", "CASTILLO", "MENDOZA", "RIVERA", "DIAZ",
+                                       "LOPEZ", "GONZALES", "PEREZ", "CONDORI", "RAMIREZ", "ESPINOZA", "CRUZ", "GUTIERREZ" },
+                                     options.surnames, rng);
+        nombres_lower.reserve(nombres.size());
+        for (const string& nombre : nombres)
+            nombres_lower.push_back(to_lower(nombre));
+        apellidos_lower.reserve(apellidos.size());
+        for (const string& apellido : apellidos)
+            apellidos_lower.push_back(to_lower(apellido));
+        name_zipf = ZipfTable(nombres.size(), options.zipf);
+        surname_zipf = ZipfTable(apellidos.size(), options.zipf);
+
+        // Cada departamento tiene de 3 a 12 provincias y cada provincia de 3 a 20 distritos; la primera
+        // subdivision es la capital y lleva el nombre de la anterior
+        vector<string> lugares = build_vocabulary({}, 6000, rng);
+        size_t next_lugar = 0;
+        auto lugar = [&]() { return next_lugar < lugares.size() ? lugares[next_lugar++] : "ZONA " + to_string(next_lugar++); };
+        for (size_t d = 0; d < size(DEPARTAMENTOS); d++) {
+            provincia_begin.push_back(provincias.size());
+            size_t count = 3 + rng() % 10;
+            for (size_t p = 0; p < count; p++) {
+                provincias.push_back(p == 0 ? string(DEPARTAMENTOS[d]) : lugar());
+                distrito_begin.push_back(distritos.size());
+                size_t districts = 3 + rng() % 18;
+                for (size_t k = 0; k < districts; k++)
+                    distritos.push_back(k == 0 ? provincias.back() : lugar());
+            }
+        }
+        provincia_begin.push_back(provincias.size());
+        distrito_begin.push_back(distritos.size());
+        for (size_t count = 1; count <= MAX_SUBDIVISIONS; count++)
+            subdivision_zipf.emplace_back(count, 1.0);
+
+        stride = options.run / options.density;
+    }
+
+    uint64_t maxDni() const {
+        uint64_t runs = (options.records + options.run - 1) / options.run;
+        return options.dni_base + static_cast<uint64_t>(runs * stride);
+    }
+
+    // DNIs en tramos consecutivos de --run separados por huecos aleatorios (ocupacion --density)
+    uint64_t dniOf(uint64_t index) const {
+        uint64_t run = index / options.run;
+        uint64_t start = static_cast<uint64_t>(run * stride);
+        uint64_t slack = static_cast<uint64_t>(stride) - options.run + 1;
+        return options.dni_base + start + draw(options.seed, run, 1) % slack + index % options.run;
+    }
+
+    Record record(uint64_t position) const {
+        uint64_t index = options.sorted ? position : order(position);
+        uint64_t seed = options.seed;
+        Record r;
+        r.dni = dniOf(index);
+        if (options.duplicates > 0 && unit(draw(seed, index, 2)) < options.duplicates)
+            r.dni = dniOf(draw(seed, index, 3) % options.records);
+        r.nombres[0] = name_zipf.pick(draw(seed, index, 4));
+        r.segundo_nombre = draw(seed, index, 5) % 10 < 6;
+        r.nombres[1] = name_zipf.pick(draw(seed, index, 6));
+        r.apellidos[0] = surname_zipf.pick(draw(seed, index, 7));
+        r.apellidos[1] = surname_zipf.pick(draw(seed, index, 8));
+        r.departamento = departamento_zipf.pick(draw(seed, index, 9));
+        r.lugar_nacimiento = draw(seed, index, 10) % 10 < 7 ? r.departamento : departamento_zipf.pick(draw(seed, index, 11));
+        r.provincia = pickWithin(provincia_begin, r.departamento, draw(seed, index, 12));
+        r.distrito = pickWithin(distrito_begin, r.provincia, draw(seed, index, 13));
+        r.via = draw(seed, index, 14) % size(VIAS);
+        r.calle = surname_zipf.pick(draw(seed, index, 15));
+        r.numero = 1 + draw(seed, index, 16) % 2000;
+        r.correo_numero = draw(seed, index, 17) % 4 == 0 ? 0 : draw(seed, index, 18) % 10000;
+        r.dominio = dominio_zipf.pick(draw(seed, index, 19));
+        r.telefono = 900000000 + draw(seed, index, 20) % 100000000;
+        uint64_t nacionalidad = draw(seed, index, 21) % 1000;
+        r.nacionalidad = nacionalidad < 980 ? 0 : nacionalidad < 995 ? 1 : 2;
+        r.sexo = draw(seed, index, 22) % 2;
+        r.estado_civil = draw(seed, index, 23) % 4;
+        return r;
+    }
+
+    void append(const Record& r, string& out) const {
+        if (options.format == FORMAT_REPLAY)
+            out += "POST /add ";
+        char digits[20];
+        char* end = to_chars(digits, digits + sizeof(digits), r.dni).ptr;
+        out.append(8 - (end - digits), '0');
+        out.append(digits, end);
+        out += ',';
+        out += nombres[r.nombres[0]];
+        if (r.segundo_nombre) {
+            out += ' ';
+            out += nombres[r.nombres[1]];
+        }
+        out += ',';
+        out += apellidos[r.apellidos[0]];
+        out += ' ';
+        out += apellidos[r.apellidos[1]];
+        out += ',';
+        out += DEPARTAMENTOS[r.lugar_nacimiento];
+        out += ',';
+        out += DEPARTAMENTOS[r.departamento];
+        out += ',';
+        out += provincias[r.provincia];
+        out += ',';
+        out += provincias[r.provincia];
+        out += ',';
+        out += distritos[r.distrito];
+        out += ',';
+        out += VIAS[r.via];
+        out += apellidos[r.calle];
+        out += ' ';
+        out.append(digits, to_chars(digits, digits + sizeof(digits), r.numero).ptr);
+        out += ',';
+        if (options.format != FORMAT_CREATE) {
+            out.append(digits, to_chars(digits, digits + sizeof(digits), r.telefono).ptr);
+            out += ',';
+        }
+        out += nombres_lower[r.nombres[0]];
+        out += '.';
+        out += apellidos_lower[r.apellidos[0]];
+        if (r.correo_numero)
+            out.append(digits, to_chars(digits, digits + sizeof(digits), r.correo_numero).ptr);
+        out += '@';
+        out += DOMINIOS[r.dominio];
+        if (options.format != FORMAT_CREATE) {
+            out += ',';
+            out += NACIONALIDADES[r.nacionalidad];
+            out += ',';
+            out += static_cast<char>('0' + r.sexo);
+            out += ',';
+            out += static_cast<char>('0' + r.estado_civil);
+        }
+        out += '\n';
+    }
+
+    void generate(size_t chunk, string& out) const {
+        size_t begin = chunk * CHUNK_RECORDS;
+        size_t end = min(options.records, begin + CHUNK_RECORDS);
+        out.clear();
+        out.reserve((end - begin) * 128);
+        for (size_t position = begin; position < end; position++)
+            append(record(position), out);
+    }
+
+private:
+    uint32_t pickWithin(const vector<size_t>& begins, size_t parent, uint64_t random) const {
+        size_t count = min(begins[parent + 1] - begins[parent], MAX_SUBDIVISIONS);
+        return begins[parent] + subdivision_zipf[count - 1].pick(random);
+    }
+
+    // Ordenados aproximadamente por poblacion para que Zipf deje a LIMA como el mas frecuente
+    static constexpr const char* DEPARTAMENTOS[] = { "LIMA", "LA LIBERTAD", "PIURA", "AREQUIPA", "CAJAMARCA", "JUNIN", "CUSCO",
+                                                     "LAMBAYEQUE", "PUNO", "ANCASH", "CALLAO", "LORETO", "ICA", "SAN MARTIN",
+                                                     "HUANUCO", "AYACUCHO", "UCAYALI", "APURIMAC", "AMAZONAS", "HUANCAVELICA",
+                                                     "TACNA", "PASCO", "TUMBES", "MOQUEGUA", "MADRE DE DIOS" };
+    static constexpr const char* DOMINIOS[] = { "gmail.com", "hotmail.com", "yahoo.com", "outlook.com", "example.com" };
+    static constexpr const char* VIAS[] = { "AV. ", "JR. ", "CALLE ", "PSJE. " };
+    static constexpr const char* NACIONALIDADES[] = { "PE", "VE", "CO" };
+
+    const Options& options;
+    Permutation order;
+    vector<string> nombres, apellidos, nombres_lower, apellidos_lower;
+    vector<string> provincias, distritos;
+    vector<size_t> provincia_begin, distrito_begin;
+    ZipfTable name_zipf, surname_zipf, departamento_zipf, dominio_zipf;
+    vector<ZipfTable> subdivision_zipf;
+    double stride;
+};
+
+// loadFile necesita el tamaño descomprimido en la cabecera del frame: se calcula antes de comprimir
+static uint64_t total_bytes(const DatasetGenerator& generator, size_t chunks, int threads) {
+    atomic<size_t> next{0};
+    atomic<uint64_t> total{0};
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            string buffer;
+            uint64_t bytes = 0;
+            for (size_t chunk = next++; chunk < chunks; chunk = next++) {
+                generator.generate(chunk, buffer);
+                bytes += buffer.size();
+            }
+            total += bytes;
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    return total;
+}
+
+static bool is_zst(const string& filename) {
+    return filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".zst") == 0;
+}
+
+// Escribe el texto tal cual, o comprimido en un solo frame de zstd si el archivo termina en .zst
+class OutputFile {
+public:
+    OutputFile(const string& filename, int level, int workers, uint64_t pledged)
+        : file(filename, ios::binary), cctx(nullptr), buffer(ZSTD_CStreamOutSize()), input_bytes(0) {
+        if (!file) {
+            cerr << "Error: No se pudo abrir " << filename << endl;
+            return;
+        }
+        if (!is_zst(filename))
+            return;
+        cctx = ZSTD_createCCtx();
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+        if (workers > 0 && ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, workers)))
+            cerr << "Aviso: libzstd sin soporte multihilo, se comprime en un solo hilo" << endl;
+        ZSTD_CCtx_setPledgedSrcSize(cctx, pledged);
+    }
+
+    ~OutputFile() {
+        ZSTD_freeCCtx(cctx);
+    }
+
+    bool isOpen() const { return static_cast<bool>(file); }
+    uint64_t inputBytes() const { return input_bytes; }
+
+    bool write(const string& data) {
+        input_bytes += data.size();
+        if (!cctx) {
+            file.write(data.data(), data.size());
+            return static_cast<bool>(file);
+        }
+        ZSTD_inBuffer input = { data.data(), data.size(), 0 };
+        while (input.pos < input.size) {
+            if (compress(input, ZSTD_e_continue) == FAILED)
+                return false;
+        }
+        return true;
+    }
+
+    bool finish() {
+        if (cctx) {
+            ZSTD_inBuffer input = { nullptr, 0, 0 };
+            size_t remaining;
+            do {
+                remaining = compress(input, ZSTD_e_end);
+                if (remaining == FAILED)
+                    return false;
+            } while (remaining > 0);
+        }
+        file.close();
+        return !file.fail();
+    }
+
+private:
+    static constexpr size_t FAILED = static_cast<size_t>(-1);
+
+    // Devuelve lo que zstd aun tiene pendiente por volcar, o FAILED
+    size_t compress(ZSTD_inBuffer& input, ZSTD_EndDirective directive) {
+        ZSTD_outBuffer output = { buffer.data(), buffer.size(), 0 };
+        size_t remaining = ZSTD_compressStream2(cctx, &output, &input, directive);
+        if (ZSTD_isError(remaining)) {
+            cerr << "Error de compresion: " << ZSTD_getErrorName(remaining) << endl;
+            return FAILED;
+        }
+        file.write(buffer.data(), output.pos);
+        return file ? remaining : FAILED;
+    }
+
+    ofstream file;
+    ZSTD_CCtx* cctx;
+    vector<char> buffer;
+    uint64_t input_bytes;
+};
+
+// Los hilos generan bloques de CHUNK_RECORDS en paralelo y el hilo principal los escribe en orden;
+// a lo sumo 2 bloques por hilo esperan en memoria
+static bool write_dataset(const DatasetGenerator& generator, OutputFile& output, size_t records, int threads) {
+    size_t chunks = (records + CHUNK_RECORDS - 1) / CHUNK_RECORDS;
+    size_t window = 2 * threads;
+    vector<string> slots(window);
+    vector<bool> ready(window, false);
+    mutex slots_mutex;
+    condition_variable produced, consumed;
+    size_t written = 0;
+    bool stop = false;
+    atomic<size_t> next{0};
+
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            string buffer;
+            for (size_t chunk = next++; chunk < chunks; chunk = next++) {
+                {
+                    unique_lock<mutex> lock(slots_mutex);
+                    consumed.wait(lock, [&]() { return stop || chunk < written + window; });
+                    if (stop)
+                        return;
+                }
+                generator.generate(chunk, buffer);
+                {
+                    lock_guard<mutex> lock(slots_mutex);
+                    swap(slots[chunk % window], buffer);
+                    ready[chunk % window] = true;
+                }
+                produced.notify_all();
+            }
+        });
+    }
+
+    bool ok = true;
+    string data;
+    for (size_t chunk = 0; chunk < chunks && ok; chunk++) {
+        {
+            unique_lock<mutex> lock(slots_mutex);
+            produced.wait(lock, [&]() { return ready[chunk % window]; });
+            swap(data, slots[chunk % window]);
+            ready[chunk % window] = false;
+            written++;
+        }
+        consumed.notify_all();
+        ok = output.write(data);
+        if (chunks >= 10 && (chunk + 1) % (chunks / 10) == 0)
+            cerr << "Generados " << min(records, (chunk + 1) * CHUNK_RECORDS) << " de " << records << " registros" << endl;
+    }
+    {
+        lock_guard<mutex> lock(slots_mutex);
+        stop = true;
+    }
+    consumed.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    string usage = string("Uso: ") + argv[0] + " [--records=33000000] [--out=datanew.zst] [--threads=N] [--zstd-workers=N] [--level=3]"
+                   " [--seed=42] [--format=create|add|replay] [--order=random|sorted] [--dni-base=1] [--density=0.4] [--run=1000]"
+                   " [--duplicates=0] [--names=3000] [--surnames=20000] [--zipf=1.0]";
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            auto value = [&arg](const string& flag) -> optional<string> {
+                if (arg.compare(0, flag.size(), flag) == 0)
+                    return arg.substr(flag.size());
+                return nullopt;
+            };
+            if (auto v = value("--records="))
+                options.records = stoull(*v);
+            else if (auto v = value("--out="))
+                options.out = *v;
+            else if (auto v = value("--threads="))
+                options.threads = max(1, stoi(*v));
+            else if (auto v = value("--zstd-workers="))
+                options.zstd_workers = max(0, stoi(*v));
+            else if (auto v = value("--level="))
+                options.level = stoi(*v);
+            else if (auto v = value("--seed="))
+                options.seed = stoull(*v);
+            else if (auto v = value("--format=")) {
+                if (*v == "create")
+                    options.format = FORMAT_CREATE;
+                else if (*v == "add")
+                    options.format = FORMAT_ADD;
+                else if (*v == "replay")
+                    options.format = FORMAT_REPLAY;
+                else
+                    throw invalid_argument(*v);
+            } else if (auto v = value("--order=")) {
+                if (*v != "random" && *v != "sorted")
+                    throw invalid_argument(*v);
+                options.sorted = *v == "sorted";
+            } else if (auto v = value("--dni-base="))
+                options.dni_base = stoull(*v);
+            else if (auto v = value("--density="))
+                options.density = stod(*v);
+            else if (auto v = value("--run="))
+                options.run = max<size_t>(1, stoull(*v));
+            else if (auto v = value("--duplicates="))
+                options.duplicates = stod(*v);
+            else if (auto v = value("--names="))
+                options.names = max<size_t>(1, stoull(*v));
+            else if (auto v = value("--surnames="))
+                options.surnames = max<size_t>(1, stoull(*v));
+            else if (auto v = value("--zipf="))
+                options.zipf = stod(*v);
+            else {
+                cerr << usage << endl;
+                return 1;
+            }
+        }
+    } catch (const exception& e) {
+        cerr << usage << endl;
+        return 1;
+    }
+    if (options.records == 0 || options.density <= 0 || options.density > 1 || options.duplicates < 0 || options.duplicates >= 1) {
+        cerr << "Se requiere --records > 0, --density en (0, 1] y --duplicates en [0, 1)" << endl;
+        return 1;
+    }
+    if (options.zstd_workers < 0)
+        options.zstd_workers = options.threads;
+
+    auto start = chrono::steady_clock::now();
+    DatasetGenerator generator(options);
+    if (generator.maxDni() > MAX_DNI) {
+        cerr << "Los DNIs no caben en 8 digitos (maximo " << generator.maxDni() << "): reduzca --records o --dni-base, o suba --density" << endl;
+        return 1;
+    }
+
+    size_t chunks = (options.records + CHUNK_RECORDS - 1) / CHUNK_RECORDS;
+    uint64_t bytes = is_zst(options.out) ? total_bytes(generator, chunks, options.threads) : 0;
+    OutputFile output(options.out, options.level, options.zstd_workers, bytes);
+    if (!output.isOpen())
+        return 1;
+    if (!write_dataset(generator, output, options.records, options.threads) || !output.finish()) {
+        cerr << "Error: No se pudo escribir " << options.out << endl;
+        return 1;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    bytes = output.inputBytes();
+    ifstream written(options.out, ios::binary | ios::ate);
+    cerr << options.records << " registros, " << bytes / 1048576.0 << " MB sin comprimir, " << written.tellg() / 1048576.0
+         << " MB en " << options.out << " (" << seconds << " s, " << bytes / 1048576.0 / seconds << " MB/s)" << endl;
+    return 0;
+}
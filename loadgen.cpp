@@ -0,0 +1,755 @@
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <optional>
+#include <cstring>
+#include <cmath>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <zstd.h>
+
+using namespace std;
+
+// Generador de carga HTTP de lazo abierto: las solicitudes se programan a un ritmo fijo y la latencia
+// se mide desde el instante programado, no desde el envio, para no ocultar las colas (omision coordinada).
+
+enum Kind { SEARCH_HIT = 0, SEARCH_MISS, ADD, DELETE, REPLAY, KIND_COUNT };
+const char* KIND_NAMES[KIND_COUNT] = { "search_hit", "search_miss", "add", "delete", "replay" };
+
+struct Options {
+    string host = "127.0.0.1";
+    string port = "5000";
+    int threads = 2;
+    int connections = 16;
+    double rate = 1000;
+    double duration = 10;
+    double warmup = 0;
+    int timeout_ms = 5000;
+    string replay;
+    string dataset;
+    size_t sample = 100000;
+    double mix[4] = { 80, 10, 5, 5 };
+    uint64_t add_base = 90000000;
+    uint64_t seed = 42;
+    string json;
+    string hgrm;
+};
+
+// Histograma log-lineal en microsegundos al estilo HdrHistogram: 1024 sub-buckets por potencia de dos
+// (error relativo menor a 0.1%) y valores exactos por debajo de 2048 us.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 10;
+    static constexpr uint64_t LINEAR_LIMIT = 1ULL << (SUB_BITS + 1);
+    static constexpr int MAX_EXPONENT = 40;
+
+    LatencyHistogram() : counts(LINEAR_LIMIT + (MAX_EXPONENT - SUB_BITS) * (1ULL << SUB_BITS), 0), total(0), sum(0), max_value(0) {}
+
+    void record(uint64_t value) {
+        counts[indexOf(value)]++;
+        total++;
+        sum += value;
+        max_value = max(max_value, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < counts.size(); i++)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        max_value = max(max_value, other.max_value);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t maxValue() const { return max_value; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0; }
+
+    // Mayor valor equivalente del bucket donde se alcanza el percentil
+    uint64_t percentile(double p) const {
+        if (total == 0)
+            return 0;
+        uint64_t target = max<uint64_t>(1, static_cast<uint64_t>(ceil(p / 100.0 * total)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen >= target)
+                return min(highestEquivalent(i), max_value);
+        }
+        return max_value;
+    }
+
+    // Distribucion de percentiles en el formato .hgrm que grafica HdrHistogram
+    void writeHgrm(ostream& out) const {
+        out << "       Value     Percentile TotalCount 1/(1-Percentile)\n\n";
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            if (counts[i] == 0)
+                continue;
+            seen += counts[i];
+            double fraction = static_cast<double>(seen) / total;
+            char line[128];
+            if (fraction < 1.0)
+                snprintf(line, sizeof(line), "%12.3f %14.12f %10llu %14.2f\n", highestEquivalent(i) / 1000.0, fraction, static_cast<unsigned long long>(seen), 1.0 / (1.0 - fraction));
+            else
+                snprintf(line, sizeof(line), "%12.3f %14.12f %10llu\n", min(highestEquivalent(i), max_value) / 1000.0, fraction, static_cast<unsigned long long>(seen));
+            out << line;
+        }
+        char footer[160];
+        snprintf(footer, sizeof(footer), "#[Mean    = %12.3f, Max     = %12.3f]\n#[Total count    = %12llu]\n", mean() / 1000.0, max_value / 1000.0, static_cast<unsigned long long>(total));
+        out << footer;
+    }
+
+private:
+    static size_t indexOf(uint64_t value) {
+        if (value < LINEAR_LIMIT)
+            return value;
+        int exponent = min(63 - __builtin_clzll(value), MAX_EXPONENT);
+        int shift = exponent - SUB_BITS;
+        uint64_t sub = min<uint64_t>(value >> shift, (2ULL << SUB_BITS) - 1) - (1ULL << SUB_BITS);
+        return LINEAR_LIMIT + (exponent - SUB_BITS - 1) * (1ULL << SUB_BITS) + sub;
+    }
+
+    static uint64_t highestEquivalent(size_t index) {
+        if (index < LINEAR_LIMIT)
+            return index;
+        size_t offset = index - LINEAR_LIMIT;
+        int shift = static_cast<int>(offset >> SUB_BITS) + 1;
+        uint64_t sub = (offset & ((1ULL << SUB_BITS) - 1)) + (1ULL << SUB_BITS);
+        return ((sub + 1) << shift) - 1;
+    }
+
+    vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max_value;
+};
+
+struct Request {
+    Kind kind;
+    string method;
+    string resource;
+    string body;
+};
+
+struct ThreadStats {
+    LatencyHistogram histograms[KIND_COUNT];
+    uint64_t sent = 0;
+    uint64_t completed = 0;
+    // Respuestas 2xx de solicitudes programadas despues del calentamiento; de aqui sale el throughput
+    uint64_t succeeded = 0;
+    uint64_t non_2xx = 0;
+    uint64_t errors = 0;
+    uint64_t timeouts = 0;
+    uint64_t unsent = 0;
+};
+
+using Clock = chrono::steady_clock;
+
+struct Connection {
+    int fd = -1;
+    bool busy = false;
+    string out;
+    size_t out_pos = 0;
+    string in;
+    Request request;
+    Clock::time_point intended;
+    Clock::time_point sent_at;
+};
+
+// Lineas de replay: "METODO /recurso[?query] [cuerpo]"; vacias o con # se ignoran
+bool load_replay(const string& filename, vector<Request>& requests) {
+    ifstream file(filename);
+    if (!file) {
+        cerr << "Error: No se pudo abrir " << filename << endl;
+        return false;
+    }
+    string line;
+    while (getline(file, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line[0] == '#')
+            continue;
+        istringstream ss(line);
+        Request request{ REPLAY, "", "", "" };
+        ss >> request.method >> request.resource;
+        if (request.resource.empty() || request.resource[0] != '/') {
+            cerr << "Linea de replay invalida: " << line << endl;
+            continue;
+        }
+        getline(ss >> ws, request.body);
+        requests.push_back(request);
+    }
+    return !requests.empty();
+}
+
+// Muestreo de reservorio de DNIs existentes a partir del mismo .zst que recibe /create
+bool sample_dnis(const string& filename, size_t sample, uint64_t seed, vector<string>& dnis) {
+    ifstream file(filename, ios::binary);
+    if (!file) {
+        cerr << "Error: No se pudo abrir " << filename << endl;
+        return false;
+    }
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    ZSTD_initDStream(stream);
+    vector<char> in_buffer(ZSTD_DStreamInSize()), out_buffer(ZSTD_DStreamOutSize());
+    mt19937_64 rng(seed);
+    string line;
+    uint64_t seen = 0;
+    bool ok = true;
+
+    auto take = [&](const string& row) {
+        size_t comma = row.find(',');
+        if (comma == string::npos || comma == 0)
+            return;
+        seen++;
+        if (dnis.size() < sample)
+            dnis.push_back(row.substr(0, comma));
+        else if (uint64_t slot = rng() % seen; slot < sample)
+            dnis[slot] = row.substr(0, comma);
+    };
+
+    while (ok && file) {
+        file.read(in_buffer.data(), in_buffer.size());
+        ZSTD_inBuffer input = { in_buffer.data(), static_cast<size_t>(file.gcount()), 0 };
+        while (input.pos < input.size) {
+            ZSTD_outBuffer output = { out_buffer.data(), out_buffer.size(), 0 };
+            size_t ret = ZSTD_decompressStream(stream, &output, &input);
+            if (ZSTD_isError(ret)) {
+                cerr << "Error de descompresion: " << ZSTD_getErrorName(ret) << endl;
+                ok = false;
+                break;
+            }
+            for (size_t i = 0; i < output.pos; i++) {
+                if (out_buffer[i] == '\n') {
+                    take(line);
+                    line.clear();
+                } else {
+                    line += out_buffer[i];
+                }
+            }
+        }
+    }
+    if (!line.empty())
+        take(line);
+    ZSTD_freeDStream(stream);
+    return ok && !dnis.empty();
+}
+
+class Worker {
+public:
+    Worker(const Options& options, int id, int connections, const vector<Request>& replay, const vector<string>& hits)
+        : options(options), id(id), replay(replay), hits(hits), rng(options.seed + id), replay_pos(id), add_seq(0) {
+        conns.resize(connections);
+        double total = 0;
+        for (double weight : options.mix)
+            total += weight;
+        double acc = 0;
+        for (int i = 0; i < 4; i++) {
+            acc += options.mix[i];
+            cumulative[i] = total > 0 ? acc / total : 0;
+        }
+    }
+
+    ~Worker() {
+        for (Connection& conn : conns)
+            if (conn.fd >= 0)
+                close(conn.fd);
+    }
+
+    bool connectAll(const addrinfo* address) {
+        this->address = address;
+        for (Connection& conn : conns)
+            if (!reconnect(conn))
+                return false;
+        return true;
+    }
+
+    void run(Clock::time_point start) {
+        auto interval = chrono::duration<double, nano>(1e9 * options.threads / options.rate);
+        // Los hilos se desfasan para que el ritmo agregado sea uniforme
+        Clock::time_point next = start + chrono::duration_cast<Clock::duration>(interval * id / options.threads);
+        Clock::time_point end = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(options.duration));
+        measure_from = start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(options.warmup));
+        uint64_t issued = 0;
+
+        vector<pollfd> fds(conns.size());
+        while (true) {
+            Clock::time_point now = Clock::now();
+            bool scheduling = next < end;
+
+            while (scheduling && next <= now) {
+                Connection* idle = nullptr;
+                for (Connection& conn : conns) {
+                    if (!conn.busy && conn.fd >= 0) {
+                        idle = &conn;
+                        break;
+                    }
+                }
+                if (!idle)
+                    break;
+                send(*idle, nextRequest(), next);
+                issued++;
+                next = start + chrono::duration_cast<Clock::duration>(interval * (issued * options.threads + id) / options.threads);
+                scheduling = next < end;
+            }
+
+            bool any_busy = false;
+            for (size_t i = 0; i < conns.size(); i++) {
+                fds[i].fd = conns[i].fd;
+                fds[i].events = conns[i].busy ? (POLLIN | (conns[i].out_pos < conns[i].out.size() ? POLLOUT : 0)) : POLLIN;
+                fds[i].revents = 0;
+                any_busy = any_busy || conns[i].busy;
+            }
+            if (!scheduling && !any_busy)
+                break;
+
+            // Esperar hasta la siguiente solicitud programada o hasta que llegue alguna respuesta
+            bool has_idle = any_of(conns.begin(), conns.end(), [](const Connection& c) { return !c.busy && c.fd >= 0; });
+            timespec timeout = { 0, 1000000 };
+            if (scheduling && has_idle) {
+                auto wait = chrono::duration_cast<chrono::nanoseconds>(next - Clock::now()).count();
+                wait = max<int64_t>(0, min<int64_t>(wait, 1000000));
+                timeout = { 0, static_cast<long>(wait) };
+            }
+            if (ppoll(fds.data(), fds.size(), &timeout, nullptr) < 0 && errno != EINTR)
+                break;
+
+            now = Clock::now();
+            for (size_t i = 0; i < conns.size(); i++) {
+                Connection& conn = conns[i];
+                if (!conn.busy) {
+                    if (fds[i].revents & (POLLIN | POLLERR | POLLHUP)) {
+                        // El servidor cerro una conexion ociosa
+                        reconnect(conn);
+                    }
+                    continue;
+                }
+                if (fds[i].revents & POLLOUT)
+                    flushOut(conn);
+                if (fds[i].revents & (POLLIN | POLLERR | POLLHUP))
+                    readIn(conn);
+                if (conn.busy && now - conn.sent_at > chrono::milliseconds(options.timeout_ms)) {
+                    stats.timeouts++;
+                    record(conn, now);
+                    reconnect(conn);
+                }
+            }
+            // Aunque quede trabajo atrasado (o todas las conexiones hayan muerto) la corrida termina a su hora
+            if (now > end + chrono::milliseconds(options.timeout_ms))
+                break;
+        }
+        // Lo que sigue en vuelo o quedo programado dentro de la duracion sin salir por falta de conexiones
+        // libres cuenta en los percentiles con lo que llevaba esperando al terminar, como en el lazo abierto
+        Clock::time_point stopped = Clock::now();
+        for (Connection& conn : conns) {
+            if (conn.busy) {
+                stats.timeouts++;
+                record(conn, stopped);
+                conn.busy = false;
+            }
+        }
+        while (next < end) {
+            stats.unsent++;
+            Request request = nextRequest();
+            if (next >= measure_from)
+                stats.histograms[request.kind].record(chrono::duration_cast<chrono::microseconds>(stopped - next).count());
+            issued++;
+            next = start + chrono::duration_cast<Clock::duration>(interval * (issued * options.threads + id) / options.threads);
+        }
+    }
+
+    const ThreadStats& getStats() const { return stats; }
+
+private:
+    bool reconnect(Connection& conn) {
+        if (conn.fd >= 0)
+            close(conn.fd);
+        conn = Connection();
+        int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (fd < 0)
+            return false;
+        if (::connect(fd, address->ai_addr, address->ai_addrlen) != 0) {
+            close(fd);
+            stats.errors++;
+            return false;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        conn.fd = fd;
+        return true;
+    }
+
+    Request nextRequest() {
+        if (!replay.empty()) {
+            const Request& request = replay[replay_pos % replay.size()];
+            replay_pos += options.threads;
+            return request;
+        }
+        double pick = uniform_real_distribution<double>(0, 1)(rng);
+        Kind kind = pick < cumulative[0] ? SEARCH_HIT : pick < cumulative[1] ? SEARCH_MISS : pick < cumulative[2] ? ADD : DELETE;
+        if (kind == SEARCH_HIT && hits.empty())
+            kind = SEARCH_MISS;
+
+        switch (kind) {
+        case SEARCH_HIT:
+            return { kind, "GET", "/search?dni=" + hits[rng() % hits.size()], "" };
+        case ADD: {
+            // DNIs nuevos por hilo para no chocar entre hilos ni con el dataset muestreado
+            string dni = to_string(options.add_base + add_seq++ * options.threads + id);
+            string body = dni + ",CARGA,PRUEBA,LIMA,LIMA,LIMA,LIMA,MIRAFLORES,CALLE " + to_string(rng() % 1000) + ",987654321,carga" + dni + "@correo.pe,PE,0,0";
+            return { kind, "POST", "/add", body };
+        }
+        case DELETE:
+            if (!added.empty()) {
+                string dni = added.front();
+                added.pop_front();
+                return { kind, "GET", "/delete?dni=" + dni, "" };
+            }
+            return { kind, "GET", "/delete?dni=" + missDni(), "" };
+        default:
+            return { SEARCH_MISS, "GET", "/search?dni=" + missDni(), "" };
+        }
+    }
+
+    // Prefijo no numerico: nunca coincide con los DNIs del dataset
+    string missDni() {
+        char dni[9];
+        snprintf(dni, sizeof(dni), "X%07u", static_cast<unsigned>(rng() % 10000000));
+        return dni;
+    }
+
+    void send(Connection& conn, Request request, Clock::time_point intended) {
+        conn.out = request.method + " " + request.resource + " HTTP/1.1\r\nHost: " + options.host + "\r\nConnection: keep-alive\r\n";
+        if (!request.body.empty() || request.method == "POST")
+            conn.out += "Content-Type: text/plain\r\nContent-Length: " + to_string(request.body.size()) + "\r\n";
+        conn.out += "\r\n" + request.body;
+        conn.out_pos = 0;
+        conn.in.clear();
+        conn.request = move(request);
+        conn.intended = intended;
+        conn.sent_at = Clock::now();
+        conn.busy = true;
+        stats.sent++;
+        flushOut(conn);
+    }
+
+    void flushOut(Connection& conn) {
+        while (conn.out_pos < conn.out.size()) {
+            ssize_t written = ::send(conn.fd, conn.out.data() + conn.out_pos, conn.out.size() - conn.out_pos, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    fail(conn);
+                return;
+            }
+            conn.out_pos += written;
+        }
+    }
+
+    void readIn(Connection& conn) {
+        char buffer[16384];
+        while (true) {
+            ssize_t got = recv(conn.fd, buffer, sizeof(buffer), 0);
+            if (got > 0) {
+                conn.in.append(buffer, got);
+                continue;
+            }
+            if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                fail(conn);
+                return;
+            }
+            break;
+        }
+        size_t header_end = conn.in.find("\r\n\r\n");
+        if (header_end == string::npos)
+            return;
+        string headers = conn.in.substr(0, header_end);
+        transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+        size_t body_size = 0;
+        size_t pos = headers.find("\r\ncontent-length:");
+        if (pos != string::npos)
+            body_size = stoul(headers.substr(pos + 17));
+        if (conn.in.size() < header_end + 4 + body_size)
+            return;
+
+        int status = 0;
+        if (conn.in.compare(0, 5, "HTTP/") == 0 && conn.in.size() > 12)
+            status = atoi(conn.in.c_str() + 9);
+        complete(conn, status);
+        if (headers.find("\r\nconnection: close") != string::npos)
+            reconnect(conn);
+    }
+
+    void complete(Connection& conn, int status) {
+        Clock::time_point now = Clock::now();
+        stats.completed++;
+        if (status < 200 || status >= 300) {
+            stats.non_2xx++;
+        } else {
+            if (conn.intended >= measure_from)
+                stats.succeeded++;
+            if (conn.request.kind == ADD)
+                added.push_back(conn.request.body.substr(0, conn.request.body.find(',')));
+        }
+        record(conn, now);
+        conn.busy = false;
+        conn.in.clear();
+    }
+
+    void fail(Connection& conn) {
+        stats.errors++;
+        if (conn.busy)
+            record(conn, Clock::now());
+        reconnect(conn);
+    }
+
+    // Las solicitudes fallidas y vencidas tambien entran al histograma con lo que llevaban esperando;
+    // si no, los percentiles ignoran justo las peores
+    void record(const Connection& conn, Clock::time_point now) {
+        if (conn.intended >= measure_from)
+            stats.histograms[conn.request.kind].record(chrono::duration_cast<chrono::microseconds>(now - conn.intended).count());
+    }
+
+    const Options& options;
+    int id;
+    const vector<Request>& replay;
+    const vector<string>& hits;
+    const addrinfo* address = nullptr;
+    vector<Connection> conns;
+    mt19937_64 rng;
+    double cumulative[4];
+    size_t replay_pos;
+    uint64_t add_seq;
+    deque<string> added;
+    Clock::time_point measure_from;
+    ThreadStats stats;
+};
+
+void print_report(ostream& out, const Options& options, const LatencyHistogram* histograms, const LatencyHistogram& total, const ThreadStats& totals, double elapsed) {
+    double measured = max(0.001, elapsed - options.warmup);
+    char line[256];
+    snprintf(line, sizeof(line), "Duracion: %.1f s (calentamiento %.1f s), %d hilos, %d conexiones\n", elapsed, options.warmup, options.threads, options.connections);
+    out << line;
+    snprintf(line, sizeof(line), "Enviadas: %llu  Completadas: %llu  No 2xx: %llu  Errores: %llu  Timeouts: %llu  No enviadas: %llu\n",
+             static_cast<unsigned long long>(totals.sent), static_cast<unsigned long long>(totals.completed), static_cast<unsigned long long>(totals.non_2xx),
+             static_cast<unsigned long long>(totals.errors), static_cast<unsigned long long>(totals.timeouts), static_cast<unsigned long long>(totals.unsent));
+    out << line;
+    // El throughput cuenta solo respuestas 2xx: los errores y timeouts tambien estan en los percentiles
+    double sent = max<double>(1, totals.sent);
+    snprintf(line, sizeof(line), "Throughput: %.1f req/s 2xx (objetivo %.1f req/s)  Errores: %.2f%%  Timeouts: %.2f%%  No 2xx: %.2f%%\n",
+             totals.succeeded / measured, options.rate, 100.0 * totals.errors / sent, 100.0 * totals.timeouts / sent, 100.0 * totals.non_2xx / sent);
+    out << line;
+    if (totals.unsent > 0) {
+        snprintf(line, sizeof(line), "Aviso: %llu solicitudes no salieron por falta de conexiones libres; cuentan con su espera hasta el final\n",
+                 static_cast<unsigned long long>(totals.unsent));
+        out << line;
+    }
+    out << "\n";
+    snprintf(line, sizeof(line), "%-12s %10s %10s %10s %10s %10s %10s %10s  (ms)\n", "ruta", "count", "p50", "p90", "p99", "p99.9", "p99.99", "max");
+    out << line;
+    auto row = [&](const char* name, const LatencyHistogram& h) {
+        snprintf(line, sizeof(line), "%-12s %10llu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name, static_cast<unsigned long long>(h.count()),
+                 h.percentile(50) / 1000.0, h.percentile(90) / 1000.0, h.percentile(99) / 1000.0, h.percentile(99.9) / 1000.0,
+                 h.percentile(99.99) / 1000.0, h.maxValue() / 1000.0);
+        out << line;
+    };
+    for (int k = 0; k < KIND_COUNT; k++)
+        if (histograms[k].count())
+            row(KIND_NAMES[k], histograms[k]);
+    row("total", total);
+}
+
+void write_json(ostream& out, const Options& options, const LatencyHistogram* histograms, const LatencyHistogram& total, const ThreadStats& totals, double elapsed) {
+    double measured = max(0.001, elapsed - options.warmup);
+    double sent = max<double>(1, totals.sent);
+    auto histogram = [&out](const LatencyHistogram& h) {
+        out << "{\"count\":" << h.count() << ",\"mean_us\":" << h.mean() << ",\"p50_us\":" << h.percentile(50) << ",\"p90_us\":" << h.percentile(90)
+            << ",\"p99_us\":" << h.percentile(99) << ",\"p999_us\":" << h.percentile(99.9) << ",\"p9999_us\":" << h.percentile(99.99) << ",\"max_us\":" << h.maxValue() << "}";
+    };
+    out << "{\"threads\":" << options.threads << ",\"connections\":" << options.connections << ",\"target_rate\":" << options.rate
+        << ",\"duration_s\":" << elapsed << ",\"warmup_s\":" << options.warmup << ",\"throughput\":" << totals.succeeded / measured
+        << ",\"sent\":" << totals.sent << ",\"completed\":" << totals.completed << ",\"succeeded\":" << totals.succeeded << ",\"non_2xx\":" << totals.non_2xx
+        << ",\"errors\":" << totals.errors << ",\"timeouts\":" << totals.timeouts << ",\"unsent\":" << totals.unsent
+        << ",\"error_rate\":" << totals.errors / sent << ",\"timeout_rate\":" << totals.timeouts / sent << ",\"routes\":{";
+    bool first = true;
+    for (int k = 0; k < KIND_COUNT; k++) {
+        if (!histograms[k].count())
+            continue;
+        out << (first ? "" : ",") << "\"" << KIND_NAMES[k] << "\":";
+        histogram(histograms[k]);
+        first = false;
+    }
+    out << "},\"total\":";
+    histogram(total);
+    out << "}" << endl;
+}
+
+bool parse_mix(const string& mix, double* weights) {
+    fill(weights, weights + 4, 0.0);
+    stringstream ss(mix);
+    string item;
+    while (getline(ss, item, ',')) {
+        size_t colon = item.find(':');
+        if (colon == string::npos)
+            return false;
+        string name = item.substr(0, colon);
+        double weight = stod(item.substr(colon + 1));
+        int k = 0;
+        while (k < 4 && name != KIND_NAMES[k])
+            k++;
+        if (k == 4 || weight < 0)
+            return false;
+        weights[k] = weight;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    string usage = string("Uso: ") + argv[0] + " [--host=127.0.0.1] [--port=5000] [--threads=2] [--connections=16] [--rate=1000] [--duration=10]"
+                   " [--warmup=0] [--timeout-ms=5000] [--replay=archivo] [--dataset=data.zst] [--sample=100000]"
+                   " [--mix=search_hit:80,search_miss:10,add:5,delete:5] [--add-base=90000000] [--seed=42] [--json=archivo] [--hgrm=archivo]";
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            auto value = [&arg](const string& flag) -> optional<string> {
+                if (arg.compare(0, flag.size(), flag) == 0)
+                    return arg.substr(flag.size());
+                return nullopt;
+            };
+            if (auto v = value("--host="))
+                options.host = *v;
+            else if (auto v = value("--port="))
+                options.port = *v;
+            else if (auto v = value("--threads="))
+                options.threads = max(1, stoi(*v));
+            else if (auto v = value("--connections="))
+                options.connections = stoi(*v);
+            else if (auto v = value("--rate="))
+                options.rate = stod(*v);
+            else if (auto v = value("--duration="))
+                options.duration = stod(*v);
+            else if (auto v = value("--warmup="))
+                options.warmup = max(0.0, stod(*v));
+            else if (auto v = value("--timeout-ms="))
+                options.timeout_ms = max(1, stoi(*v));
+            else if (auto v = value("--replay="))
+                options.replay = *v;
+            else if (auto v = value("--dataset="))
+                options.dataset = *v;
+            else if (auto v = value("--sample="))
+                options.sample = max<size_t>(1, stoull(*v));
+            else if (auto v = value("--mix=")) {
+                if (!parse_mix(*v, options.mix)) {
+                    cerr << "Mezcla invalida: " << *v << endl;
+                    return 1;
+                }
+            } else if (auto v = value("--add-base="))
+                options.add_base = stoull(*v);
+            else if (auto v = value("--seed="))
+                options.seed = stoull(*v);
+            else if (auto v = value("--json="))
+                options.json = *v;
+            else if (auto v = value("--hgrm="))
+                options.hgrm = *v;
+            else {
+                cerr << usage << endl;
+                return 1;
+            }
+        }
+    } catch (const exception& e) {
+        cerr << usage << endl;
+        return 1;
+    }
+    if (options.rate <= 0 || options.duration <= 0 || options.warmup >= options.duration) {
+        cerr << "Se requiere --rate > 0 y --duration mayor que --warmup" << endl;
+        return 1;
+    }
+    options.connections = max(options.connections, options.threads);
+
+    vector<Request> replay;
+    if (!options.replay.empty() && !load_replay(options.replay, replay))
+        return 1;
+    vector<string> hits;
+    if (replay.empty() && options.mix[SEARCH_HIT] > 0) {
+        if (options.dataset.empty()) {
+            cerr << "search_hit necesita --dataset para conocer DNIs existentes" << endl;
+            return 1;
+        }
+        if (!sample_dnis(options.dataset, options.sample, options.seed, hits))
+            return 1;
+        cerr << hits.size() << " DNIs muestreados de " << options.dataset << endl;
+    }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* address = nullptr;
+    if (getaddrinfo(options.host.c_str(), options.port.c_str(), &hints, &address) != 0 || !address) {
+        cerr << "Error: No se pudo resolver " << options.host << ":" << options.port << endl;
+        return 1;
+    }
+
+    vector<unique_ptr<Worker>> workers;
+    for (int i = 0; i < options.threads; i++) {
+        int connections = options.connections / options.threads + (i < options.connections % options.threads ? 1 : 0);
+        workers.emplace_back(new Worker(options, i, connections, replay, hits));
+        if (!workers.back()->connectAll(address)) {
+            cerr << "Error: No se pudo conectar a " << options.host << ":" << options.port << endl;
+            freeaddrinfo(address);
+            return 1;
+        }
+    }
+
+    Clock::time_point start = Clock::now() + chrono::milliseconds(10);
+    vector<thread> threads;
+    for (auto& worker : workers)
+        threads.emplace_back([&worker, start] { worker->run(start); });
+    for (auto& t : threads)
+        t.join();
+    double elapsed = min(chrono::duration<double>(Clock::now() - start).count(), options.duration);
+    freeaddrinfo(address);
+
+    LatencyHistogram histograms[KIND_COUNT];
+    LatencyHistogram total;
+    ThreadStats totals;
+    for (auto& worker : workers) {
+        const ThreadStats& stats = worker->getStats();
+        for (int k = 0; k < KIND_COUNT; k++) {
+            histograms[k].merge(stats.histograms[k]);
+            total.merge(stats.histograms[k]);
+        }
+        totals.sent += stats.sent;
+        totals.completed += stats.completed;
+        totals.succeeded += stats.succeeded;
+        totals.non_2xx += stats.non_2xx;
+        totals.errors += stats.errors;
+        totals.timeouts += stats.timeouts;
+        totals.unsent += stats.unsent;
+    }
+
+    print_report(cout, options, histograms, total, totals, elapsed);
+    if (!options.json.empty()) {
+        ofstream file(options.json);
+        write_json(file, options, histograms, total, totals, elapsed);
+    }
+    if (!options.hgrm.empty()) {
+        ofstream file(options.hgrm);
+        total.writeHgrm(file);
+    }
+    return totals.completed > 0 ? 0 : 1;
+}
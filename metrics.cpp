@@ -0,0 +1,177 @@
+#include "metrics.h"
+
+#include <cstdio>
+#include <iomanip>
+#include <unistd.h>
+#include <malloc.h>
+
+using namespace std;
+
+static const char* ROUTE_NAMES[ROUTE_COUNT] = {
+    "/create", "/save", "/open", "/search", "/delete", "/add", "/savepages", "/openpages", "/pagestats", "/metrics", "/suggest", "other"
+};
+
+Route route_of(const string& resource) {
+    for (int route = 0; route < ROUTE_OTHER; route++)
+        if (resource == ROUTE_NAMES[route])
+            return static_cast<Route>(route);
+    return ROUTE_OTHER;
+}
+
+// Un solo escritor por contador: basta con carga y almacenamiento relajados
+static inline void bump(atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+static atomic<uint64_t> next_metrics_id{1};
+
+Metrics::Metrics() : id(next_metrics_id.fetch_add(1, memory_order_relaxed)) {}
+
+// Cada hilo tiene un bloque por instancia; el ultimo usado queda a mano para no buscar en el mapa
+Metrics::ThreadBlock& Metrics::local() {
+    thread_local uint64_t last_id = 0;
+    thread_local ThreadBlock* last_block = nullptr;
+    thread_local unordered_map<uint64_t, ThreadBlock*> by_instance;
+    if (last_id == id)
+        return *last_block;
+    ThreadBlock*& block = by_instance[id];
+    if (!block) {
+        auto created = make_unique<ThreadBlock>();
+        block = created.get();
+        lock_guard<mutex> lock(blocks_mutex);
+        blocks.push_back(move(created));
+    }
+    last_id = id;
+    last_block = block;
+    return *block;
+}
+
+void Metrics::observe(Route route, uint64_t nanos) {
+    ThreadBlock& block = local();
+    int bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && nanos > BUCKET_BOUNDS[bucket])
+        bucket++;
+    bump(block.buckets[route][bucket], 1);
+    bump(block.count[route], 1);
+    bump(block.sum_ns[route], nanos);
+}
+
+void Metrics::recordAdmin(const string& operation, const StageTimer& timer, bool ok) {
+    AdminRecord record{ operation, timer.elapsed(), timer.getStages(), ok,
+                        chrono::duration<double>(chrono::system_clock::now().time_since_epoch()).count() };
+    lock_guard<mutex> lock(admin_mutex);
+    for (auto& existing : admin) {
+        if (existing.operation == operation) {
+            existing = move(record);
+            return;
+        }
+    }
+    admin.push_back(move(record));
+}
+
+static size_t resident_bytes() {
+    ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident))
+        return 0;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+string Metrics::render(const Btree& tree, const PagedBtree& paged) const {
+    ostringstream out;
+    out.precision(15);
+
+    uint64_t buckets[ROUTE_COUNT][BUCKET_COUNT] = {};
+    uint64_t count[ROUTE_COUNT] = {};
+    uint64_t sum_ns[ROUTE_COUNT] = {};
+    {
+        lock_guard<mutex> lock(blocks_mutex);
+        for (const auto& block : blocks) {
+            for (int r = 0; r < ROUTE_COUNT; r++) {
+                for (int b = 0; b < BUCKET_COUNT; b++)
+                    buckets[r][b] += block->buckets[r][b].load(memory_order_relaxed);
+                count[r] += block->count[r].load(memory_order_relaxed);
+                sum_ns[r] += block->sum_ns[r].load(memory_order_relaxed);
+            }
+        }
+    }
+
+    out << "# HELP edav_http_requests_total Solicitudes atendidas por ruta.\n";
+    out << "# TYPE edav_http_requests_total counter\n";
+    for (int r = 0; r < ROUTE_COUNT; r++)
+        out << "edav_http_requests_total{route=\"" << ROUTE_NAMES[r] << "\"} " << count[r] << "\n";
+
+    // Las rutas de administracion solo miden el encolado; su duracion real esta en edav_admin_*
+    out << "# HELP edav_http_request_duration_seconds Tiempo dentro del handler por ruta.\n";
+    out << "# TYPE edav_http_request_duration_seconds histogram\n";
+    for (int r = 0; r < ROUTE_COUNT; r++) {
+        uint64_t cumulative = 0;
+        for (int b = 0; b < BUCKET_COUNT; b++) {
+            cumulative += buckets[r][b];
+            out << "edav_http_request_duration_seconds_bucket{route=\"" << ROUTE_NAMES[r] << "\",le=\"";
+            if (b < BUCKET_COUNT - 1)
+                out << BUCKET_BOUNDS[b] / 1e9;
+            else
+                out << "+Inf";
+            out << "\"} " << cumulative << "\n";
+        }
+        out << "edav_http_request_duration_seconds_sum{route=\"" << ROUTE_NAMES[r] << "\"} " << sum_ns[r] / 1e9 << "\n";
+        out << "edav_http_request_duration_seconds_count{route=\"" << ROUTE_NAMES[r] << "\"} " << count[r] << "\n";
+    }
+
+    TreeStats stats = tree.stats();
+    size_t capacity = stats.nodes * (2 * static_cast<size_t>(stats.degree) - 1);
+    auto gauge = [&out](const char* name, const char* help, double value) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " gauge\n" << name << " " << value << "\n";
+    };
+    gauge("edav_tree_degree", "Grado minimo t del B-Tree.", stats.degree);
+    gauge("edav_tree_height", "Altura del B-Tree en memoria.", stats.height);
+    gauge("edav_tree_nodes", "Nodos del B-Tree en memoria.", stats.nodes);
+    gauge("edav_tree_fill_factor", "Claves ocupadas sobre la capacidad de los nodos (2t-1).", capacity ? static_cast<double>(stats.keys) / capacity : 0);
+    gauge("edav_tree_records", "Registros vivos (sin lapidas).", stats.keys - min(stats.keys, stats.tombstones));
+    gauge("edav_tree_tombstones", "Registros marcados como eliminados pendientes de purga.", stats.tombstones);
+    gauge("edav_string_pool_entries", "Cadenas internadas en el string pool.", stats.pool_entries);
+    gauge("edav_string_pool_bytes", "Bytes de texto en el string pool.", stats.pool_bytes);
+    gauge("edav_paged_tree_open", "1 si las busquedas se atienden desde el archivo de paginas.", paged.isOpen() ? 1 : 0);
+
+    // Los contadores vuelven a cero con cada /openpages
+    BufferPoolStats pool = paged.pool_stats();
+    auto counter = [&out](const char* name, const char* help, uint64_t value) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n" << name << " " << value << "\n";
+    };
+    gauge("edav_buffer_pool_frames", "Marcos de pagina del buffer pool.", pool.frames);
+    gauge("edav_buffer_pool_resident_pages", "Paginas cargadas en el buffer pool.", pool.resident_pages);
+    counter("edav_buffer_pool_hits_total", "Paginas pedidas que ya estaban en el buffer pool.", pool.hits);
+    counter("edav_buffer_pool_misses_total", "Paginas pedidas que se leyeron del archivo.", pool.misses);
+    counter("edav_buffer_pool_evictions_total", "Paginas desalojadas del buffer pool.", pool.evictions);
+    counter("edav_buffer_pool_writebacks_total", "Paginas sucias escritas al archivo.", pool.writebacks);
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    gauge("edav_malloc_in_use_bytes", "Bytes reservados con malloc y en uso.", info.uordblks + info.hblkhd);
+    gauge("edav_malloc_free_bytes", "Bytes libres retenidos por malloc.", info.fordblks);
+    gauge("edav_malloc_mmap_bytes", "Bytes reservados por malloc con mmap.", info.hblkhd);
+#endif
+    gauge("process_resident_memory_bytes", "Memoria residente del proceso.", resident_bytes());
+
+    lock_guard<mutex> lock(admin_mutex);
+    out << "# HELP edav_admin_last_duration_seconds Duracion de la ultima ejecucion de cada operacion.\n";
+    out << "# TYPE edav_admin_last_duration_seconds gauge\n";
+    for (const auto& record : admin)
+        out << "edav_admin_last_duration_seconds{operation=\"" << record.operation << "\"} " << record.duration << "\n";
+    out << "# HELP edav_admin_last_stage_duration_seconds Desglose por etapa de la ultima ejecucion.\n";
+    out << "# TYPE edav_admin_last_stage_duration_seconds gauge\n";
+    for (const auto& record : admin)
+        for (const auto& stage : record.stages)
+            out << "edav_admin_last_stage_duration_seconds{operation=\"" << record.operation << "\",stage=\"" << stage.first << "\"} " << stage.second << "\n";
+    out << "# HELP edav_admin_last_success 1 si la ultima ejecucion termino bien.\n";
+    out << "# TYPE edav_admin_last_success gauge\n";
+    for (const auto& record : admin)
+        out << "edav_admin_last_success{operation=\"" << record.operation << "\"} " << (record.ok ? 1 : 0) << "\n";
+    out << "# HELP edav_admin_last_timestamp_seconds Momento en que termino la ultima ejecucion.\n";
+    out << "# TYPE edav_admin_last_timestamp_seconds gauge\n";
+    out << fixed << setprecision(3);
+    for (const auto& record : admin)
+        out << "edav_admin_last_timestamp_seconds{operation=\"" << record.operation << "\"} " << record.timestamp << "\n";
+    return out.str();
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "btree.h"
+
+// Rutas instrumentadas; el indice ubica los contadores de cada ruta dentro del bloque de un hilo
+enum Route {
+    ROUTE_CREATE,
+    ROUTE_SAVE,
+    ROUTE_OPEN,
+    ROUTE_SEARCH,
+    ROUTE_DELETE,
+    ROUTE_ADD,
+    ROUTE_SAVEPAGES,
+    ROUTE_OPENPAGES,
+    ROUTE_PAGESTATS,
+    ROUTE_METRICS,
+    ROUTE_SUGGEST,
+    ROUTE_OTHER,
+    ROUTE_COUNT
+};
+
+Route route_of(const std::string& resource);
+
+// Contadores e histogramas de latencia por ruta. Cada hilo escribe solo en su propio bloque, sin locks
+// ni instrucciones atomicas de lectura-modificacion-escritura; /metrics suma los bloques al leerlos.
+class Metrics {
+public:
+    Metrics();
+
+    static constexpr int BUCKET_COUNT = 25;
+    // Limites superiores en nanosegundos; el ultimo bucket es +Inf
+    static constexpr uint64_t BUCKET_BOUNDS[BUCKET_COUNT - 1] = {
+        1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000,
+        10000000, 25000000, 50000000, 100000000, 250000000, 500000000, 1000000000, 2500000000, 5000000000, 10000000000, 30000000000, 60000000000
+    };
+
+    void observe(Route route, uint64_t nanos);
+    // Ultima ejecucion de una operacion de administracion con su desglose por etapas
+    void recordAdmin(const std::string& operation, const StageTimer& timer, bool ok);
+
+    // Exposicion en formato de texto de Prometheus
+    std::string render(const Btree& tree, const PagedBtree& paged) const;
+
+private:
+    struct alignas(64) ThreadBlock {
+        std::atomic<uint64_t> buckets[ROUTE_COUNT][BUCKET_COUNT];
+        std::atomic<uint64_t> count[ROUTE_COUNT];
+        std::atomic<uint64_t> sum_ns[ROUTE_COUNT];
+    };
+
+    struct AdminRecord {
+        std::string operation;
+        double duration;
+        std::vector<std::pair<std::string, double>> stages;
+        bool ok;
+        double timestamp;
+    };
+
+    ThreadBlock& local();
+
+    // Identifica la instancia en la cache de bloques de cada hilo; no se reutiliza como una direccion
+    const uint64_t id;
+    mutable std::mutex blocks_mutex;
+    std::vector<std::unique_ptr<ThreadBlock>> blocks;
+    mutable std::mutex admin_mutex;
+    std::vector<AdminRecord> admin;
+};
+
+// Registra la duracion del handler al salir de onRequest
+class RequestTimer {
+public:
+    RequestTimer(Metrics& metrics, Route route) : metrics(metrics), route(route), start(std::chrono::steady_clock::now()) {}
+    ~RequestTimer() {
+        metrics.observe(route, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+private:
+    Metrics& metrics;
+    Route route;
+    std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,294 @@
+#include "suggest.h"
+
+using namespace std;
+
+static const char* FIELD_NAMES[FIELD_COUNT] = {
+    "nombres", "apellidos", "lugar_nacimiento", "departamento", "provincia", "ciudad", "distrito", "ubicacion", "correo"
+};
+
+optional<Field> field_from_name(const string& name) {
+    for (int field = 0; field < FIELD_COUNT; field++)
+        if (name == FIELD_NAMES[field])
+            return static_cast<Field>(field);
+    return nullopt;
+}
+
+const char* field_name(Field field) {
+    return FIELD_NAMES[field];
+}
+
+uint32_t field_value(const Ciudadano& citizen, Field field) {
+    switch (field) {
+    case FIELD_NOMBRES: return citizen.getNombres();
+    case FIELD_APELLIDOS: return citizen.getApellidos();
+    case FIELD_LUGAR_NACIMIENTO: return citizen.getLugarNacimiento();
+    case FIELD_DEPARTAMENTO: return citizen.getDireccion().departamento;
+    case FIELD_PROVINCIA: return citizen.getDireccion().provincia;
+    case FIELD_CIUDAD: return citizen.getDireccion().ciudad;
+    case FIELD_DISTRITO: return citizen.getDireccion().distrito;
+    case FIELD_UBICACION: return citizen.getDireccion().ubicacion;
+    default: return citizen.getCorreo();
+    }
+}
+
+static void write_varint(string& out, size_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static size_t read_varint(const char*& p) {
+    size_t value = 0;
+    int shift = 0;
+    while (static_cast<unsigned char>(*p) & 0x80) {
+        value |= static_cast<size_t>(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= static_cast<size_t>(static_cast<unsigned char>(*p++)) << shift;
+    return value;
+}
+
+static bool starts_with(const string& str, const string& prefix) {
+    return str.size() >= prefix.size() && str.compare(0, prefix.size(), prefix) == 0;
+}
+
+void FrontCodedList::build(const vector<pair<string, uint32_t>>& sorted) {
+    data.clear();
+    block_offsets.clear();
+    counts.clear();
+    counts.reserve(sorted.size());
+    const string* previous = nullptr;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const string& str = sorted[i].first;
+        if (i % BLOCK_SIZE == 0) {
+            block_offsets.push_back(data.size());
+            write_varint(data, str.size());
+            data += str;
+        } else {
+            size_t lcp = 0;
+            size_t max_lcp = min(previous->size(), str.size());
+            while (lcp < max_lcp && (*previous)[lcp] == str[lcp])
+                lcp++;
+            write_varint(data, lcp);
+            write_varint(data, str.size() - lcp);
+            data.append(str, lcp, string::npos);
+        }
+        counts.push_back(sorted[i].second);
+        previous = &str;
+    }
+    data.shrink_to_fit();
+}
+
+string FrontCodedList::blockHead(size_t block) const {
+    const char* p = data.data() + block_offsets[block];
+    size_t size = read_varint(p);
+    return string(p, size);
+}
+
+// Avanza una posicion decodificando la siguiente cadena sobre current
+static void decode_next(const char*& p, size_t i, string& current) {
+    if (i % FrontCodedList::BLOCK_SIZE == 0) {
+        size_t size = read_varint(p);
+        current.assign(p, size);
+        p += size;
+    } else {
+        size_t lcp = read_varint(p);
+        size_t suffix = read_varint(p);
+        current.resize(lcp);
+        current.append(p, suffix);
+        p += suffix;
+    }
+}
+
+void FrontCodedList::decodeAll(vector<pair<string, uint32_t>>& out) const {
+    out.reserve(out.size() + counts.size());
+    const char* p = data.data();
+    string current;
+    for (size_t i = 0; i < counts.size(); i++) {
+        decode_next(p, i, current);
+        if (counts[i] > 0)
+            out.emplace_back(current, counts[i]);
+    }
+}
+
+size_t FrontCodedList::startBlock(const string& str) const {
+    // Primer bloque cuya cabeza es >= str; la primera cadena >= str puede estar en el bloque anterior
+    size_t lo = 0, hi = block_offsets.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (blockHead(mid) < str)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo > 0 ? lo - 1 : 0;
+}
+
+void FrontCodedList::scan(const string& prefix, size_t limit, vector<pair<string, uint32_t>>& out) const {
+    if (counts.empty() || limit == 0)
+        return;
+    size_t block = startBlock(prefix);
+    const char* p = data.data() + block_offsets[block];
+    string current;
+    size_t found = 0;
+    for (size_t i = block * BLOCK_SIZE; i < counts.size(); i++) {
+        decode_next(p, i, current);
+        if (current < prefix)
+            continue;
+        if (!starts_with(current, prefix))
+            break;
+        if (counts[i] == 0)
+            continue;
+        out.emplace_back(current, counts[i]);
+        if (++found == limit)
+            break;
+    }
+}
+
+size_t FrontCodedList::find(const string& str) const {
+    if (counts.empty())
+        return 0;
+    size_t block = startBlock(str);
+    const char* p = data.data() + block_offsets[block];
+    string current;
+    for (size_t i = block * BLOCK_SIZE; i < counts.size(); i++) {
+        decode_next(p, i, current);
+        if (current == str)
+            return i;
+        if (current > str)
+            break;
+    }
+    return counts.size();
+}
+
+SuggestIndex::SuggestIndex() {
+    // ubicacion y correo son casi unicos por registro: se indexan solo si se piden con --suggest-fields
+    for (int field = 0; field < FIELD_COUNT; field++)
+        indexed[field] = field != FIELD_UBICACION && field != FIELD_CORREO;
+    fill(begin(dead), end(dead), 0);
+}
+
+void SuggestIndex::setFields(const vector<Field>& fields) {
+    unique_lock<RwLock> lock(index_mutex);
+    fill(begin(indexed), end(indexed), false);
+    for (Field field : fields)
+        indexed[field] = true;
+}
+
+void SuggestIndex::build(const Btree& tree) {
+    // Sin /add ni /delete durante los recorridos: lo que hay en pending pertenece al arbol anterior
+    lock_guard<mutex> update_lock(update_mutex);
+
+    // Un recorrido por campo con un solo arreglo de contadores por indice del pool
+    FrontCodedList built[FIELD_COUNT];
+    vector<uint32_t> counts;
+    for (int field = 0; field < FIELD_COUNT; field++) {
+        if (!indexed[field])
+            continue;
+        counts.assign(tree.pool_size(), 0);
+        tree.forEachRecord([&](const Ciudadano& citizen) {
+            uint32_t value = field_value(citizen, static_cast<Field>(field));
+            if (value >= counts.size())
+                counts.resize(value + 1, 0);
+            counts[value]++;
+            return true;
+        });
+
+        vector<pair<string, uint32_t>> entries;
+        for (uint32_t value = 0; value < counts.size(); value++)
+            if (counts[value] > 0)
+                entries.emplace_back(tree.get_string_from_pool(value), counts[value]);
+        sort(entries.begin(), entries.end());
+        built[field].build(entries);
+    }
+
+    unique_lock<RwLock> lock(index_mutex);
+    for (int field = 0; field < FIELD_COUNT; field++) {
+        lists[field] = move(built[field]);
+        pending[field].clear();
+        dead[field] = 0;
+    }
+}
+
+void SuggestIndex::add(const Btree& tree, const Ciudadano& citizen) {
+    unique_lock<RwLock> lock(index_mutex);
+    for (int field = 0; field < FIELD_COUNT; field++) {
+        if (!indexed[field])
+            continue;
+        string value = tree.get_string_from_pool(field_value(citizen, static_cast<Field>(field)));
+        size_t pos = lists[field].find(value);
+        if (pos < lists[field].size()) {
+            if (lists[field].count(pos)++ == 0)
+                dead[field]--;
+            continue;
+        }
+
+        auto& entries = pending[field];
+        auto it = lower_bound(entries.begin(), entries.end(), make_pair(value, uint32_t(0)));
+        if (it != entries.end() && it->first == value)
+            it->second++;
+        else
+            entries.insert(it, make_pair(value, uint32_t(1)));
+        if (needsMerge(static_cast<Field>(field)))
+            mergePending(static_cast<Field>(field));
+    }
+}
+
+void SuggestIndex::remove(const Btree& tree, const Ciudadano& citizen) {
+    unique_lock<RwLock> lock(index_mutex);
+    for (int field = 0; field < FIELD_COUNT; field++) {
+        if (!indexed[field])
+            continue;
+        string value = tree.get_string_from_pool(field_value(citizen, static_cast<Field>(field)));
+        size_t pos = lists[field].find(value);
+        if (pos < lists[field].size()) {
+            uint32_t& count = lists[field].count(pos);
+            if (count > 0 && --count == 0) {
+                dead[field]++;
+                if (needsMerge(static_cast<Field>(field)))
+                    mergePending(static_cast<Field>(field));
+            }
+            continue;
+        }
+
+        auto& entries = pending[field];
+        auto it = lower_bound(entries.begin(), entries.end(), make_pair(value, uint32_t(0)));
+        if (it != entries.end() && it->first == value && --it->second == 0)
+            entries.erase(it);
+    }
+}
+
+bool SuggestIndex::needsMerge(Field field) const {
+    return pending[field].size() + dead[field] >= max(MIN_PENDING_LIMIT, lists[field].size() / 16);
+}
+
+void SuggestIndex::mergePending(Field field) {
+    vector<pair<string, uint32_t>> entries;
+    lists[field].decodeAll(entries);
+    size_t middle = entries.size();
+    entries.insert(entries.end(), pending[field].begin(), pending[field].end());
+    inplace_merge(entries.begin(), entries.begin() + middle, entries.end());
+    lists[field].build(entries);
+    pending[field].clear();
+    dead[field] = 0;
+}
+
+vector<pair<string, uint32_t>> SuggestIndex::suggest(Field field, const string& prefix, size_t limit) const {
+    shared_lock<RwLock> lock(index_mutex);
+    vector<pair<string, uint32_t>> from_list, from_pending, result;
+    lists[field].scan(prefix, limit, from_list);
+
+    const auto& entries = pending[field];
+    for (auto it = lower_bound(entries.begin(), entries.end(), make_pair(prefix, uint32_t(0))); it != entries.end() && from_pending.size() < limit; ++it) {
+        if (!starts_with(it->first, prefix))
+            break;
+        from_pending.push_back(*it);
+    }
+
+    merge(from_list.begin(), from_list.end(), from_pending.begin(), from_pending.end(), back_inserter(result));
+    if (result.size() > limit)
+        result.resize(limit);
+    return result;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "btree.h"
+
+// Campos de Ciudadano que guardan un indice del string pool
+enum Field {
+    FIELD_NOMBRES,
+    FIELD_APELLIDOS,
+    FIELD_LUGAR_NACIMIENTO,
+    FIELD_DEPARTAMENTO,
+    FIELD_PROVINCIA,
+    FIELD_CIUDAD,
+    FIELD_DISTRITO,
+    FIELD_UBICACION,
+    FIELD_CORREO,
+    FIELD_COUNT
+};
+
+std::optional<Field> field_from_name(const std::string& name);
+const char* field_name(Field field);
+uint32_t field_value(const Ciudadano& citizen, Field field);
+
+// Lista ordenada de cadenas con codificacion por prefijo comun (front coding) en bloques de 16:
+// cada bloque guarda su primera cadena completa y las demas como (prefijo compartido, sufijo).
+// La busqueda por prefijo es una busqueda binaria sobre las cabezas de bloque y un recorrido corto.
+// Cada cadena lleva la cantidad de registros vivos con ese valor.
+class FrontCodedList {
+public:
+    static constexpr size_t BLOCK_SIZE = 16;
+
+    void build(const std::vector<std::pair<std::string, uint32_t>>& sorted);
+    // Solo las cadenas con registros vivos
+    void decodeAll(std::vector<std::pair<std::string, uint32_t>>& out) const;
+    // Hasta limit cadenas con registros vivos que empiezan con prefix, en orden, con su cantidad
+    void scan(const std::string& prefix, size_t limit, std::vector<std::pair<std::string, uint32_t>>& out) const;
+    // Posicion de str en la lista, o size() si no esta
+    size_t find(const std::string& str) const;
+
+    uint32_t& count(size_t pos) { return counts[pos]; }
+    size_t size() const { return counts.size(); }
+    size_t bytes() const { return data.size() + block_offsets.size() * sizeof(uint64_t) + counts.size() * sizeof(uint32_t); }
+
+private:
+    std::string blockHead(size_t block) const;
+    // Primer bloque donde puede estar la primera cadena >= str
+    size_t startBlock(const std::string& str) const;
+
+    std::string data;
+    std::vector<uint64_t> block_offsets;
+    std::vector<uint32_t> counts;
+};
+
+// Indice de autocompletado por campo sobre las cadenas internadas. Se construye en /create y /open;
+// los valores nuevos de /add van a un conjunto ordenado pequeño que se fusiona con la lista al crecer.
+// Un valor sin registros vivos deja de sugerirse y sale de la lista en la siguiente fusion.
+class SuggestIndex {
+public:
+    SuggestIndex();
+
+    void setFields(const std::vector<Field>& fields);
+    bool isIndexed(Field field) const { return indexed[field]; }
+
+    void build(const Btree& tree);
+    // Los cambios del arbol y sus add/remove van dentro de update para que un build no quede en medio
+    template <class Change>
+    void update(Change change) {
+        std::lock_guard<std::mutex> lock(update_mutex);
+        change();
+    }
+    void add(const Btree& tree, const Ciudadano& citizen);
+    void remove(const Btree& tree, const Ciudadano& citizen);
+
+    // Pares (valor, registros vivos con ese valor)
+    std::vector<std::pair<std::string, uint32_t>> suggest(Field field, const std::string& prefix, size_t limit) const;
+
+    static constexpr size_t MIN_PENDING_LIMIT = 4096;
+
+private:
+    bool needsMerge(Field field) const;
+    void mergePending(Field field);
+
+    bool indexed[FIELD_COUNT];
+    FrontCodedList lists[FIELD_COUNT];
+    std::vector<std::pair<std::string, uint32_t>> pending[FIELD_COUNT];
+    // Entradas de la lista que quedaron en cero
+    size_t dead[FIELD_COUNT];
+    std::mutex update_mutex;
+    mutable RwLock index_mutex;
+};